@@ -47,11 +47,19 @@ int main(int argc, char *argv[]) {
 Application::Application(char *infile) {
 	int i;
 	par = new Params();
-	srand (time(NULL));
 	par->setparams(infile);
+	rng = par->newRandom();
+	cout<<"Random seed: "<<par->SEED<<endl;
 	log = new Log(par);
 	en = new EmulNet(par);
-	en1 = new EmulNet(par);
+	// the KV store talks on its own channel of the membership network unless SHARED_NET is 0
+	en1 = par->SHARED_NET ? en : new EmulNet(par);
+	pool = new WorkerPool(par->NUM_THREADS);
+	en->ENsetSlots(pool->size());
+	if ( en1 != en ) {
+		en1->ENsetSlots(pool->size());
+	}
+	log->setSlots(pool->size());
 	mp1 = (MP1Node **) malloc(par->EN_GPSZ * sizeof(MP1Node *));
 	mp2 = (MP2Node **) malloc(par->EN_GPSZ * sizeof(MP2Node *));
 
@@ -77,9 +85,12 @@ Application::Application(char *infile) {
  * Destructor
  */
 Application::~Application() {
+	delete pool;
 	delete log;
+	if ( en1 != en ) {
+		delete en1;
+	}
 	delete en;
-	delete en1;
 	for ( int i = 0; i < par->EN_GPSZ; i++ ) {
 		delete mp1[i];
 		delete mp2[i];
@@ -100,10 +111,15 @@ int Application::run()
 	int timeWhenAllNodesHaveJoined = 0;
 	// boolean indicating if all nodes have joined
 	bool allNodesJoined = false;
-	srand(time(NULL));
 
 	// As time runs along
 	for( par->globaltime = 0; par->globaltime < TOTAL_RUNNING_TIME; ++par->globaltime ) {
+		// Messages whose link delay runs out now reach the inboxes
+		en->ENtick();
+		if ( en1 != en ) {
+			en1->ENtick();
+		}
+
 		// Run the membership protocol
 		mp1Run();
 
@@ -122,7 +138,9 @@ int Application::run()
 
 	// Clean up
 	en->ENcleanup();
-	en1->ENcleanup();
+	if ( en1 != en ) {
+		en1->ENcleanup();
+	}
 
 	for(i=0;i<=par->EN_GPSZ-1;i++) {
 		 mp1[i]->finishUpThisNode();
@@ -139,8 +157,8 @@ int Application::run()
 void Application::mp1Run() {
 	int i;
 
-	// For all the nodes in the system
-	for( i = 0; i <= par->EN_GPSZ-1; i++) {
+	// For all the nodes in the system, in parallel
+	pool->run(par->EN_GPSZ, [this](int i) {
 
 		/*
 		 * Receive messages from the network and queue them in the membership protocol queue
@@ -150,10 +168,13 @@ void Application::mp1Run() {
 			mp1[i]->recvLoop();
 		}
 
-	}
+	});
+	en->ENflush();
+	log->flush();
 
-	// For all the nodes in the system
-	for( i = par->EN_GPSZ - 1; i >= 0; i-- ) {
+	// For all the nodes in the system, last node first, in parallel
+	pool->run(par->EN_GPSZ, [this](int k) {
+		int i = par->EN_GPSZ - 1 - k;
 
 		/*
 		 * Introduce nodes into the distributed system
@@ -161,14 +182,12 @@ void Application::mp1Run() {
 		if( par->getcurrtime() == (int)(par->STEP_RATE*i) ) {
 			// introduce the ith node into the system at time STEPRATE*i
 			mp1[i]->nodeStart(JOINADDR, par->PORTNUM);
-			cout<<i<<"-th introduced node is assigned with the address: "<<mp1[i]->getMemberNode()->addr.getAddress() << endl;
-			nodeCount += i;
 		}
 
 		/*
 		 * Handle all the messages in your queue and send heartbeats
 		 */
-		else if( par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
+		else if( par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) && !stalled(i) ) {
 			// handle messages and send heartbeats
 			mp1[i]->nodeLoop();
 			#ifdef DEBUGLOG
@@ -178,6 +197,16 @@ void Application::mp1Run() {
 			#endif
 		}
 
+	});
+	en->ENflush();
+	log->flush();
+
+	// Account for the nodes introduced in this tick
+	for( i = par->EN_GPSZ - 1; i >= 0; i-- ) {
+		if( par->getcurrtime() == (int)(par->STEP_RATE*i) ) {
+			cout<<i<<"-th introduced node is assigned with the address: "<<mp1[i]->getMemberNode()->addr.getAddress() << endl;
+			nodeCount += i;
+		}
 	}
 }
 
@@ -190,10 +219,8 @@ void Application::mp1Run() {
  * 				2) CRUD operations
  */
 void Application::mp2Run() {
-	int i;
-
-	// For all the nodes in the system
-	for( i = 0; i <= par->EN_GPSZ-1; i++) {
+	// For all the nodes in the system, in parallel
+	pool->run(par->EN_GPSZ, [this](int i) {
 
 		/*
 		 * 1) Update the ring
@@ -207,16 +234,21 @@ void Application::mp2Run() {
 			// Step 2
 			mp2[i]->recvLoop();
 		}
-	}
+	});
+	en1->ENflush();
+	log->flush();
 
 	/**
 	 * Handle messages from the queue and update the DHT
 	 */
-	for ( i = par->EN_GPSZ-1; i >= 0; i-- ) {
+	pool->run(par->EN_GPSZ, [this](int k) {
+		int i = par->EN_GPSZ - 1 - k;
 		if ( par->getcurrtime() > (int)(par->STEP_RATE*i) && !mp2[i]->getMemberNode()->bFailed ) {
 			mp2[i]->checkMessages();
 		}
-	}
+	});
+	en1->ENflush();
+	log->flush();
 
 	/**
 	 * Insert a set of test key value pairs into the system
@@ -324,6 +356,9 @@ void Application::mp2Run() {
 		} // End of update test
 
 	} // end of if ( par->getcurrtime == TEST_TIME)
+
+	// the client requests above leave this tick too
+	en1->ENflush();
 }
 
 /**
@@ -342,14 +377,14 @@ void Application::fail() {
 	}
 
 	if( par->SINGLE_FAILURE && par->getcurrtime() == 100 ) {
-		removed = (rand() % par->EN_GPSZ);
+		removed = rng.nextInt(par->EN_GPSZ);
 		#ifdef DEBUGLOG
 		log->LOG(&mp1[removed]->getMemberNode()->addr, "Node failed at time=%d", par->getcurrtime());
 		#endif
 		mp1[removed]->getMemberNode()->bFailed = true;
 	}
 	else if( par->getcurrtime() == 100 ) {
-		removed = rand() % par->EN_GPSZ/2;
+		removed = rng.nextInt(par->EN_GPSZ/2);
 		for ( i = removed; i < removed + par->EN_GPSZ/2; i++ ) {
 			#ifdef DEBUGLOG
 			log->LOG(&mp1[i]->getMemberNode()->addr, "Node failed at time = %d", par->getcurrtime());
@@ -364,6 +399,16 @@ void Application::fail() {
 
 }
 
+/**
+ * FUNCTION NAME: stalled
+ *
+ * DESCRIPTION: Whether node i is one of the SLOW_NODES overloaded nodes and skips its
+ * 				membership loop this tick. Its messages keep arriving and queue up.
+ */
+bool Application::stalled(int i) {
+	return i >= par->EN_GPSZ - par->SLOW_NODES && par->SLOW_PERIOD > 1 && 0 != par->getcurrtime() % par->SLOW_PERIOD;
+}
+
 /**
  * FUNCTION NAME: getjoinaddr
  *
@@ -387,7 +432,7 @@ Address Application::getjoinaddr(void){
 int Application::findARandomNodeThatIsAlive() {
 	int number;
 	do {
-		number = (rand()%par->EN_GPSZ);
+		number = rng.nextInt(par->EN_GPSZ);
 	}while (mp2[number]->getMemberNode()->bFailed);
 	return number;
 }
@@ -398,7 +443,6 @@ int Application::findARandomNodeThatIsAlive() {
  * DESCRIPTION: Init NUMBER_OF_INSERTS test KV pairs in the map
  */
 void Application::initTestKVPairs() {
-	srand(time(NULL));
 	int i;
 	string key;
 	key.clear();
@@ -406,9 +450,13 @@ void Application::initTestKVPairs() {
 	int alphanumLen = sizeof(alphanum) - 1;
 	while ( testKVPairs.size() != NUMBER_OF_INSERTS ) {
 		for ( i = 0; i < KEY_LENGTH; i++ ) {
-			key.push_back(alphanum[rand()%alphanumLen]);
+			key.push_back(alphanum[rng.nextInt(alphanumLen)]);
+		}
+		string value = "value" + to_string(rng.nextInt(NUMBER_OF_INSERTS));
+		// large values to measure the store against value size
+		if ( par->VALUE_SIZE > (int)value.size() ) {
+			value.append(par->VALUE_SIZE - value.size(), '.');
 		}
-		string value = "value" + to_string(rand()%NUMBER_OF_INSERTS);
 		testKVPairs[key] = value;
 		key.clear();
 	}
@@ -17,6 +17,7 @@
 #include "MP2Node.h"
 #include "Node.h"
 #include "common.h"
+#include "WorkerPool.h"
 
 /**
  * global variables
@@ -57,6 +58,10 @@ private:
 	MP1Node **mp1;
 	MP2Node **mp2;
 	Params *par;
+	// runs the per-node loops of a tick in parallel
+	WorkerPool *pool;
+	// drives failures and the test workload
+	Random rng;
 	map<string, string> testKVPairs;
 public:
 	Application(char *);
@@ -67,6 +72,7 @@ public:
 	void mp1Run();
 	void mp2Run();
 	void fail();
+	bool stalled(int i);
 	void insertTestKVPairs();
 	int findARandomNodeThatIsAlive();
 	void deleteTest();
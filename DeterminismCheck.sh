@@ -0,0 +1,53 @@
+#!/bin/bash
+
+#################################################
+# FILE NAME: DeterminismCheck.sh
+#
+# DESCRIPTION: Runs every test case once with NUM_THREADS 1 and once with
+#              NUM_THREADS N, same seed and message drops, and checks that
+#              dbg.log, msgcount.log and stdout come out the same. The
+#              frame pool line of msgcount.log is left out, its peak in use
+#              depends on how the nodes are spread over the threads.
+#
+# RUN PROCEDURE:
+# $ chmod +x DeterminismCheck.sh
+# $ ./DeterminismCheck.sh [N, 4 by default]
+#################################################
+
+THREADS=${1:-4}
+APP="$(pwd)/Application"
+WORK=$(mktemp -d)
+STATUS=0
+
+trap 'rm -rf "${WORK}"' EXIT
+
+for conf in testcases/*.conf
+do
+	name=$(basename "${conf}" .conf)
+	for n in 1 ${THREADS}
+	do
+		mkdir -p "${WORK}/${name}.${n}"
+		cat "${conf}" > "${WORK}/${name}.${n}/run.conf"
+		printf "\nSEED: 42\nDROP_MSG: 1\nMSG_DROP_PROB: 0.1\nNUM_THREADS: %d\n" "${n}" >> "${WORK}/${name}.${n}/run.conf"
+		( cd "${WORK}/${name}.${n}" && "${APP}" run.conf > stdout.log 2> /dev/null )
+	done
+	one="${WORK}/${name}.1"
+	many="${WORK}/${name}.${THREADS}"
+	if ! cmp -s "${one}/dbg.log" "${many}/dbg.log"
+	then
+		echo "${name}: dbg.log differs between 1 and ${THREADS} threads"
+		STATUS=1
+	elif ! diff -q <(grep -v "^frame pool:" "${one}/msgcount.log") <(grep -v "^frame pool:" "${many}/msgcount.log") > /dev/null
+	then
+		echo "${name}: msgcount.log differs between 1 and ${THREADS} threads"
+		STATUS=1
+	elif ! cmp -s "${one}/stdout.log" "${many}/stdout.log"
+	then
+		echo "${name}: stdout differs between 1 and ${THREADS} threads"
+		STATUS=1
+	else
+		echo "${name}: same with 1 and ${THREADS} threads"
+	fi
+done
+
+exit ${STATUS}
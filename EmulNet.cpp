@@ -5,6 +5,9 @@
  **********************************/
 
 #include "EmulNet.h"
+#include "StatsFile.h"
+
+int EmulNet::cleanedUpNets = 0;
 
 /**
  * Constructor
@@ -12,17 +15,33 @@
 EmulNet::EmulNet(Params *p)
 {
 	//trace.funcEntry("EmulNet::EmulNet");
-	int i,j;
 	par = p;
+	rng = par->newRandom();
+	wheel.resize(EN_WHEEL_SIZE);
 	emulnet.setNextId(1);
 	emulnet.settCurrBuffSize(0);
 	enInited=0;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			sent_msgs[i][j] = 0;
-			recv_msgs[i][j] = 0;
-		}
-	}
+	copiedBytes = 0;
+	deliveredMsgs = 0;
+	fullMsgs = 0;
+	sentFrames = 0;
+	packedMsgs = 0;
+	nextFragId = 0;
+	fragmentedMsgs = 0;
+	sentFrags = 0;
+	droppedFrags = 0;
+	reassembledMsgs = 0;
+	expiredMsgs = 0;
+	compressTries = 0;
+	compressedFrames = 0;
+	rawBytes = 0;
+	wireBytes = 0;
+	compressNsec = 0;
+	decompressedFrames = 0;
+	decompressNsec = 0;
+	traffic.resize(EN_LAYERS * EN_MAX_TYPES);
+	typeNames.resize(EN_LAYERS * EN_MAX_TYPES);
+	cleanedUp = false;
 	//trace.funcExit("EmulNet::EmulNet", SUCCESS);
 }
 
@@ -30,32 +49,70 @@ EmulNet::EmulNet(Params *p)
  * Copy constructor
  */
 EmulNet::EmulNet(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
+	this->rng = anotherEmulNet.rng;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->copiedBytes = anotherEmulNet.copiedBytes;
+	this->deliveredMsgs = anotherEmulNet.deliveredMsgs;
+	this->fullMsgs = anotherEmulNet.fullMsgs;
+	this->sentFrames = anotherEmulNet.sentFrames;
+	this->packedMsgs = anotherEmulNet.packedMsgs;
+	this->nextFragId = anotherEmulNet.nextFragId;
+	this->fragmentedMsgs = anotherEmulNet.fragmentedMsgs;
+	this->sentFrags = anotherEmulNet.sentFrags;
+	this->droppedFrags = anotherEmulNet.droppedFrags;
+	this->reassembledMsgs = anotherEmulNet.reassembledMsgs;
+	this->expiredMsgs = anotherEmulNet.expiredMsgs;
+	this->compressTries = anotherEmulNet.compressTries;
+	this->compressedFrames = anotherEmulNet.compressedFrames;
+	this->rawBytes = anotherEmulNet.rawBytes;
+	this->wireBytes = anotherEmulNet.wireBytes;
+	this->compressNsec = anotherEmulNet.compressNsec;
+	this->decompressedFrames = anotherEmulNet.decompressedFrames;
+	this->decompressNsec = anotherEmulNet.decompressNsec;
+	this->traffic = anotherEmulNet.traffic;
+	this->typeNames = anotherEmulNet.typeNames;
+	this->cleanedUp = anotherEmulNet.cleanedUp;
+	this->sent_msgs = anotherEmulNet.sent_msgs;
+	this->recv_msgs = anotherEmulNet.recv_msgs;
+	this->full_msgs = anotherEmulNet.full_msgs;
 	this->emulnet = anotherEmulNet.emulnet;
+	this->wheel.resize(EN_WHEEL_SIZE);
 }
 
 /**
  * Assignment operator overloading
  */
 EmulNet& EmulNet::operator =(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
+	this->rng = anotherEmulNet.rng;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->copiedBytes = anotherEmulNet.copiedBytes;
+	this->deliveredMsgs = anotherEmulNet.deliveredMsgs;
+	this->fullMsgs = anotherEmulNet.fullMsgs;
+	this->sentFrames = anotherEmulNet.sentFrames;
+	this->packedMsgs = anotherEmulNet.packedMsgs;
+	this->nextFragId = anotherEmulNet.nextFragId;
+	this->fragmentedMsgs = anotherEmulNet.fragmentedMsgs;
+	this->sentFrags = anotherEmulNet.sentFrags;
+	this->droppedFrags = anotherEmulNet.droppedFrags;
+	this->reassembledMsgs = anotherEmulNet.reassembledMsgs;
+	this->expiredMsgs = anotherEmulNet.expiredMsgs;
+	this->compressTries = anotherEmulNet.compressTries;
+	this->compressedFrames = anotherEmulNet.compressedFrames;
+	this->rawBytes = anotherEmulNet.rawBytes;
+	this->wireBytes = anotherEmulNet.wireBytes;
+	this->compressNsec = anotherEmulNet.compressNsec;
+	this->decompressedFrames = anotherEmulNet.decompressedFrames;
+	this->decompressNsec = anotherEmulNet.decompressNsec;
+	this->traffic = anotherEmulNet.traffic;
+	this->typeNames = anotherEmulNet.typeNames;
+	this->cleanedUp = anotherEmulNet.cleanedUp;
+	this->sent_msgs = anotherEmulNet.sent_msgs;
+	this->recv_msgs = anotherEmulNet.recv_msgs;
+	this->full_msgs = anotherEmulNet.full_msgs;
 	this->emulnet = anotherEmulNet.emulnet;
+	this->wheel.resize(EN_WHEEL_SIZE);
 	return *this;
 }
 
@@ -77,60 +134,565 @@ void *EmulNet::ENinit(Address *myaddr, short port) {
 }
 
 /**
- * FUNCTION NAME: ENsend
+ * FUNCTION NAME: ENgetFrame
  *
- * DESCRIPTION: EmulNet send function
+ * DESCRIPTION: Hand out an outbound frame with room for size payload bytes.
+ * 				The caller serializes straight into it and passes it to ENsendFrame.
+ * 				layer and type say what the frame carries, for the traffic accounting.
  *
  * RETURNS:
- * size
+ * pointer to the payload area of the frame
  */
-int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
-	en_msg *em;
-	static char temp[2048];
-	int sendmsg = rand() % 100;
+char *EmulNet::ENgetFrame(int size, int layer, int type) {
+	en_msg *em = (en_msg *)pool.alloc(sizeof(en_msg) + size);
+	em->size = size;
+	em->batch = 0;
+	em->frag = 0;
+	em->raw = 0;
+	em->layer = ( layer >= 0 && layer < EN_LAYERS ) ? layer : EN_LAYER_NONE;
+	em->type = type;
+	return (char *)(em + 1);
+}
+
+/**
+ * FUNCTION NAME: ENnameType
+ *
+ * DESCRIPTION: Name a message type of a layer in the traffic table of ENcleanup
+ */
+void EmulNet::ENnameType(int layer, int type, const char *name) {
+	typeNames[trafficIndex(layer, type)] = name;
+}
+
+/**
+ * FUNCTION NAME: ENsendFrame
+ *
+ * DESCRIPTION: EmulNet send function for a frame obtained from ENgetFrame.
+ * 				The frame is queued as is, EmulNet takes it over in every case.
+ * 				Inside a parallel phase the frame waits in the outbox of the slot
+ * 				and is only put on the network by ENflush.
+ *
+ * RETURNS:
+ * size, 0 if the message was dropped, -1 if the network buffer is full
+ */
+int EmulNet::ENsendFrame(Address *myaddr, Address *toaddr, char *data, int size) {
+	en_msg *em = (en_msg *)ENframeOf(data);
 
-	if( (emulnet.currbuffsize >= ENBUFFSIZE) || (size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE) || (par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100)) ) {
+	em->size = size;
+	memcpy(&(em->from.addr), &(myaddr->addr), sizeof(em->from.addr));
+
+	return send(em, toaddr);
+}
+
+/**
+ * FUNCTION NAME: ENsendMulti
+ *
+ * DESCRIPTION: Send one frame obtained from ENgetFrame to every node of toList.
+ * 				The payload is not copied: each destination holds a reference to
+ * 				the same frame, so receivers must treat it as read only.
+ *
+ * RETURNS:
+ * number of destinations the frame was put on the network for
+ */
+int EmulNet::ENsendMulti(Address *myaddr, vector<Address> &toList, char *data, int size) {
+	en_msg *em = (en_msg *)ENframeOf(data);
+	int sent = 0;
+
+	if ( toList.empty() ) {
+		FramePool::release(em);
 		return 0;
 	}
 
-	em = (en_msg *)malloc(sizeof(en_msg) + size);
 	em->size = size;
-
 	memcpy(&(em->from.addr), &(myaddr->addr), sizeof(em->from.addr));
-	memcpy(&(em->to.addr), &(toaddr->addr), sizeof(em->from.addr));
-	memcpy(em + 1, data, size);
 
-	emulnet.buff[emulnet.currbuffsize++] = em;
+	// one reference per destination, each one is dropped on its own
+	for ( unsigned int i = 1; i < toList.size(); i++ ) {
+		FramePool::retain(em);
+	}
+	for ( unsigned int i = 0; i < toList.size(); i++ ) {
+		if ( send(em, &toList[i]) > 0 ) {
+			sent++;
+		}
+	}
+
+	return sent;
+}
+
+/**
+ * FUNCTION NAME: send
+ *
+ * DESCRIPTION: Hand one reference to a frame to the network. Inside a parallel
+ * 				phase it waits in the outbox of the slot and is only put on the
+ * 				network by ENflush.
+ *
+ * RETURNS:
+ * size, 0 if the message was dropped, -1 if the network buffer is full
+ */
+int EmulNet::send(en_msg *em, Address *toaddr) {
+	int slot = WorkerPool::currentSlot();
+	if ( slot >= 0 ) {
+		en_hop hop;
+		hop.em = em;
+		hop.to = *toaddr;
+		slots[slot].outbox.push_back(hop);
+		return em->size;
+	}
+
+	return deliver(em, toaddr);
+}
 
-	int src = *(int *)(myaddr->addr);
+/**
+ * FUNCTION NAME: deliver
+ *
+ * DESCRIPTION: Put a filled in frame on the network, or drop it
+ *
+ * RETURNS:
+ * size, 0 if the message was dropped, -1 if the network buffer is full
+ */
+int EmulNet::deliver(en_msg *em, Address *toaddr) {
+	// a shared frame may have been compressed already for another destination
+	int size = em->raw ? em->raw : em->size;
+	int src = *(int *)(em->from.addr);
 	int time = par->getcurrtime();
 
-	assert(src <= MAX_NODES);
-	assert(time < MAX_TIME);
+	if ( par->EN_BUFFSIZE > 0 && emulnet.currbuffsize >= par->EN_BUFFSIZE ) {
+		// backpressure, not loss: counted apart from the emulated drops
+		FramePool::release(em);
+		fullMsgs++;
+		countMsg(full_msgs, src, time, 1);
+		return -1;
+	}
+
+	if ( par->COMPRESS && (!par->COALESCE || size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE) ) {
+		// frames that are coalesced are compressed once packed, see sealBatch
+		compress(em);
+	}
+
+	if ( em->size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE ) {
+		// too big for one frame, each fragment is dropped and delayed on its own
+		countMsg(sent_msgs, src, time, 1);
+		countTraffic(true, src, time, em->layer, em->type, size);
+		fragment(em, toaddr);
+		return size;
+	}
+
+	if( par->dropmsg && rng.nextInt(100) < (int) (par->MSG_DROP_PROB * 100) ) {
+		FramePool::release(em);
+		return 0;
+	}
 
-	sent_msgs[src][time]++;
+	emulnet.currbuffsize++;
+	countMsg(sent_msgs, src, time, 1);
+	countTraffic(true, src, time, em->layer, em->type, size);
 
-	#ifdef DEBUGLOG
-		sprintf(temp, "Sending 4+%d B msg type %d to %d.%d.%d.%d:%d ", size-4, *(int *)data, toaddr->addr[0], toaddr->addr[1], toaddr->addr[2], toaddr->addr[3], *(short *)&toaddr->addr[4]);
-	#endif
+	// a batch has no room to tell which of its messages are compressed
+	if ( par->COALESCE && 0 == em->raw ) {
+		coalesce(em, toaddr);
+	}
+	else {
+		route(em, toaddr);
+	}
 
 	return size;
 }
 
+/**
+ * FUNCTION NAME: route
+ *
+ * DESCRIPTION: Put one frame on its link
+ */
+void EmulNet::route(en_msg *em, Address *toaddr) {
+	// without delay the message is seen by the next ENrecv, as before
+	int delay = linkDelay(em, toaddr);
+	if ( 0 == delay ) {
+		emulnet.inbox[EM::key(toaddr, em->layer)].frames.push(em);
+	}
+	else {
+		en_hop hop;
+		hop.em = em;
+		hop.to = *toaddr;
+		hop.due = par->getcurrtime() + 1 + delay;
+		wheel[hop.due % EN_WHEEL_SIZE].push_back(hop);
+	}
+	sentFrames++;
+	// fragments are counted with their message in fragment
+	if ( !em->frag ) {
+		rawBytes += em->raw ? em->raw : em->size;
+		wireBytes += em->size;
+	}
+}
+
+/**
+ * FUNCTION NAME: ENmaxPayload
+ *
+ * DESCRIPTION: Largest message that goes out in a single frame
+ */
+int EmulNet::ENmaxPayload() {
+	return par->MAX_MSG_SIZE - (int)sizeof(en_msg) - 1;
+}
+
+/**
+ * FUNCTION NAME: fragChunk
+ *
+ * DESCRIPTION: Bytes of a message carried by one fragment
+ */
+int EmulNet::fragChunk() {
+	return par->MAX_MSG_SIZE - (int)sizeof(en_msg) - (int)sizeof(en_frag) - 1;
+}
+
+/**
+ * FUNCTION NAME: fragment
+ *
+ * DESCRIPTION: Cut a message that does not fit MAX_MSG_SIZE into fragments and
+ * 				route each of them. Fragments bypass coalescing, they are full
+ * 				frames already.
+ */
+void EmulNet::fragment(en_msg *em, Address *toaddr) {
+	int chunk = fragChunk();
+	int count = (em->size + chunk - 1) / chunk;
+	int id = nextFragId++;
+
+	for ( int i = 0; i < count; i++ ) {
+		if ( par->dropmsg && rng.nextInt(100) < (int) (par->MSG_DROP_PROB * 100) ) {
+			droppedFrags++;
+			continue;
+		}
+		int length = min(chunk, em->size - i * chunk);
+		en_msg *piece = (en_msg *)pool.alloc(sizeof(en_msg) + sizeof(en_frag) + length);
+		piece->size = sizeof(en_frag) + length;
+		piece->from = em->from;
+		piece->batch = 0;
+		piece->frag = 1;
+		piece->raw = 0;
+		piece->layer = em->layer;
+		piece->type = em->type;
+		en_frag *hdr = (en_frag *)(piece + 1);
+		hdr->id = id;
+		hdr->index = i;
+		hdr->count = count;
+		hdr->total = em->size;
+		hdr->raw = em->raw;
+		memcpy(hdr + 1, (char *)(em + 1) + i * chunk, length);
+		copiedBytes += length;
+
+		emulnet.currbuffsize++;
+		route(piece, toaddr);
+	}
+	fragmentedMsgs++;
+	sentFrags += count;
+	rawBytes += em->raw ? em->raw : em->size;
+	wireBytes += em->size;
+
+	FramePool::release(em);
+}
+
+/**
+ * FUNCTION NAME: reassemble
+ *
+ * DESCRIPTION: Copy a fragment into the reassembly buffer of its message
+ *
+ * RETURNS:
+ * the whole message once its last fragment is in, NULL before
+ */
+en_msg *EmulNet::reassemble(en_inbox &box, en_msg *em, long &copied) {
+	en_frag *hdr = (en_frag *)(em + 1);
+	unsigned long long key = ((unsigned long long)*(unsigned int *)(em->from.addr) << 32) | (unsigned int)hdr->id;
+	en_reasm &partial = box.partial[key];
+
+	if ( NULL == partial.frame ) {
+		partial.frame = (en_msg *)ENframeOf(ENgetFrame(hdr->total));
+		partial.frame->from = em->from;
+		partial.frame->raw = hdr->raw;
+		partial.frame->layer = em->layer;
+		partial.frame->type = em->type;
+		partial.firstTick = par->getcurrtime();
+	}
+	int length = em->size - (int)sizeof(en_frag);
+	memcpy((char *)(partial.frame + 1) + hdr->index * fragChunk(), hdr + 1, length);
+	copied += length;
+	partial.received++;
+
+	int count = hdr->count;
+	FramePool::release(em);
+	if ( partial.received < count ) {
+		return NULL;
+	}
+
+	en_msg *whole = partial.frame;
+	box.partial.erase(key);
+	return whole;
+}
+
+/**
+ * FUNCTION NAME: compress
+ *
+ * DESCRIPTION: Compress the payload of a frame in place when it has at least
+ * 				COMPRESS_MIN bytes and comes out smaller. The raw field travels
+ * 				with the frame, so whatever the receiver's own setting it knows to
+ * 				decompress. A frame shared by several destinations is compressed
+ * 				by the first of them.
+ */
+void EmulNet::compress(en_msg *em) {
+	if ( em->raw || em->frag || em->size < par->COMPRESS_MIN ) {
+		return;
+	}
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	codecBuf.resize(em->size);
+	int size = LzCodec::compress((char *)(em + 1), em->size, codecBuf.data(), em->size - 1);
+	if ( size > 0 ) {
+		memcpy((char *)(em + 1), codecBuf.data(), size);
+		em->raw = em->size;
+		em->size = size;
+		compressedFrames++;
+	}
+	compressTries++;
+	compressNsec += nsecSince(&start);
+}
+
+/**
+ * FUNCTION NAME: decompress
+ *
+ * DESCRIPTION: Expand a compressed frame into a new one. The frame may be shared
+ * 				with other receivers, so it is never expanded in place.
+ *
+ * RETURNS:
+ * the expanded frame, NULL if the payload did not decompress
+ */
+en_msg *EmulNet::decompress(en_msg *em, long &nsec) {
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	en_msg *plain = (en_msg *)ENframeOf(ENgetFrame(em->raw));
+	int size = LzCodec::decompress((char *)(em + 1), em->size, (char *)(plain + 1), em->raw);
+	plain->from = em->from;
+	plain->batch = em->batch;
+	plain->layer = em->layer;
+	plain->type = em->type;
+	bool ok = size == em->raw;
+	FramePool::release(em);
+	if ( !ok ) {
+		FramePool::release(plain);
+		plain = NULL;
+	}
+	nsec += nsecSince(&start);
+	return plain;
+}
+
+/**
+ * FUNCTION NAME: nsecSince
+ *
+ * DESCRIPTION: Nanoseconds of CLOCK_MONOTONIC elapsed since start
+ */
+long EmulNet::nsecSince(struct timespec *start) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000000000L + (now.tv_nsec - start->tv_nsec);
+}
+
+/**
+ * FUNCTION NAME: coalesce
+ *
+ * DESCRIPTION: Add the frame to the batch of its link. A batch that would outgrow
+ * 				MAX_MSG_SIZE goes out at once and a new one is opened.
+ */
+void EmulNet::coalesce(en_msg *em, Address *toaddr) {
+	unsigned long long link = linkKey(&em->from, toaddr);
+	int bytes = (int)sizeof(en_part) + em->size;
+
+	unordered_map<unsigned long long, int> &open = openBatch[em->layer];
+
+	auto it = open.find(link);
+	if ( it != open.end() ) {
+		en_batch &batch = batches[it->second];
+		if ( batch.bytes + bytes + (int)sizeof(en_msg) < par->MAX_MSG_SIZE ) {
+			batch.frames.push_back(em);
+			batch.bytes += bytes;
+			return;
+		}
+		sealBatch(batch);
+	}
+
+	open[link] = batches.size();
+	batches.push_back(en_batch());
+	batches.back().frames.push_back(em);
+	batches.back().to = *toaddr;
+	batches.back().bytes = bytes;
+}
+
+/**
+ * FUNCTION NAME: sealBatch
+ *
+ * DESCRIPTION: Pack the frames of a batch into one frame and route it. A lone
+ * 				frame is routed as it is.
+ */
+void EmulNet::sealBatch(en_batch &batch) {
+	if ( batch.frames.empty() ) {
+		return;
+	}
+	if ( 1 == batch.frames.size() ) {
+		route(batch.frames[0], &batch.to);
+		batch.frames.clear();
+		return;
+	}
+
+	en_msg *packed = (en_msg *)pool.alloc(sizeof(en_msg) + batch.bytes);
+	packed->size = batch.bytes;
+	packed->from = batch.frames[0]->from;
+	packed->batch = batch.frames.size();
+	packed->frag = 0;
+	packed->raw = 0;
+	// the messages keep their own tags, the packed frame only needs the channel
+	packed->layer = batch.frames[0]->layer;
+	packed->type = 0;
+
+	char *pos = (char *)(packed + 1);
+	for ( unsigned int i = 0; i < batch.frames.size(); i++ ) {
+		en_msg *em = batch.frames[i];
+		en_part part;
+		part.size = em->size;
+		part.layer = em->layer;
+		part.type = em->type;
+		memcpy(pos, &part, sizeof(en_part));
+		memcpy(pos + sizeof(en_part), em + 1, em->size);
+		pos += sizeof(en_part) + em->size;
+		copiedBytes += em->size;
+		FramePool::release(em);
+	}
+	packedMsgs += batch.frames.size();
+	batch.frames.clear();
+
+	if ( par->COMPRESS ) {
+		compress(packed);
+	}
+	route(packed, &batch.to);
+}
+
+/**
+ * FUNCTION NAME: sealBatches
+ *
+ * DESCRIPTION: Route the batches of the tick, in the order they were opened
+ *
+ * RETURNS:
+ * number of batches routed
+ */
+int EmulNet::sealBatches() {
+	int sealed = 0;
+	for ( unsigned int i = 0; i < batches.size(); i++ ) {
+		if ( !batches[i].frames.empty() ) {
+			sealBatch(batches[i]);
+			sealed++;
+		}
+	}
+	batches.clear();
+	for ( int i = 0; i < EN_LAYERS; i++ ) {
+		openBatch[i].clear();
+	}
+	return sealed;
+}
+
+/**
+ * FUNCTION NAME: linkKey
+ *
+ * DESCRIPTION: Link a frame travels on. EmulNet ports are always 0, the ids
+ * 				identify a link.
+ */
+unsigned long long EmulNet::linkKey(Address *from, Address *to) {
+	return ((unsigned long long)*(unsigned int *)(from->addr) << 32) | *(unsigned int *)(to->addr);
+}
+
+/**
+ * FUNCTION NAME: linkDelay
+ *
+ * DESCRIPTION: Ticks the message spends on its link on top of the usual next-tick
+ * 				delivery: the latency, a jitter draw and the time it waits for the
+ * 				link to carry what was queued before it
+ */
+int EmulNet::linkDelay(en_msg *em, Address *toaddr) {
+	int delay = par->LATENCY;
+	int time = par->getcurrtime();
+
+	if ( par->JITTER > 0 ) {
+		if ( EXPONENTIAL_DIST == par->LATENCY_DIST ) {
+			// capped so a single draw cannot park a message for the whole run
+			double draw = -par->JITTER * log(1.0 - rng.nextDouble());
+			delay += (int)min(draw, 10.0 * par->JITTER);
+		}
+		else {
+			delay += rng.nextInt(par->JITTER + 1);
+		}
+	}
+
+	if ( par->BANDWIDTH > 0 ) {
+		double &freeAt = linkFreeAt[linkKey(&em->from, toaddr)];
+		freeAt = max(freeAt, (double)time) + (double)em->size / par->BANDWIDTH;
+		delay += (int)(freeAt - time);
+	}
+
+	return delay;
+}
+
+/**
+ * FUNCTION NAME: ENtick
+ *
+ * DESCRIPTION: Move the messages due at the current tick from the timer wheel
+ * 				into the inboxes. Only one bucket is looked at; messages in it that
+ * 				are due a later turn of the wheel stay where they are.
+ *
+ * RETURNS:
+ * number of messages that arrived
+ */
+int EmulNet::ENtick() {
+	int time = par->getcurrtime();
+	vector<en_hop> &bucket = wheel[time % EN_WHEEL_SIZE];
+	int arrived = 0;
+	unsigned int kept = 0;
+
+	for ( unsigned int i = 0; i < bucket.size(); i++ ) {
+		en_hop &hop = bucket[i];
+		if ( hop.due > time ) {
+			bucket[kept++] = hop;
+			continue;
+		}
+		emulnet.inbox[EM::key(&hop.to, hop.em->layer)].frames.push(hop.em);
+		arrived++;
+	}
+	bucket.resize(kept);
+
+	return arrived;
+}
+
+/**
+ * FUNCTION NAME: ENsend
+ *
+ * DESCRIPTION: EmulNet send function, copies data into a new frame
+ *
+ * RETURNS:
+ * size, 0 if the message was dropped, -1 if the network buffer is full
+ */
+int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
+	char *frame = ENgetFrame(size);
+	memcpy(frame, data, size);
+	int slot = WorkerPool::currentSlot();
+	if ( slot >= 0 ) {
+		slots[slot].copiedBytes += size;
+	}
+	else {
+		copiedBytes += size;
+	}
+	return ENsendFrame(myaddr, toaddr, frame, size);
+}
+
 /**
  * FUNCTION NAME: ENsend
  *
  * DESCRIPTION: EmulNet send function
  *
  * RETURNS:
- * size
+ * size, 0 if the message was dropped, -1 if the network buffer is full
  */
 int EmulNet::ENsend(Address *myaddr, Address *toaddr, string data) {
-	char * str = (char *) malloc(data.length() * sizeof(char));
-	memcpy(str, data.c_str(), data.size());
-	int ret = this->ENsend(myaddr, toaddr, str, (data.length() * sizeof(char)));
-	free(str);
-	return ret;
+	return this->ENsend(myaddr, toaddr, (char *)data.data(), (data.length() * sizeof(char)));
 }
 
 /**
@@ -141,80 +703,488 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, string data) {
  * RETURN:
  * 0
  */
-int EmulNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue){
+int EmulNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue, int channel){
 	// times is always assumed to be 1
-	int i;
-	char* tmp;
-	int sz;
 	en_msg *emsg;
 
-	for( i = emulnet.currbuffsize - 1; i >= 0; i-- ) {
-		emsg = emulnet.buff[i];
+	auto box = emulnet.inbox.find(EM::key(myaddr, channel));
+	if ( box == emulnet.inbox.end() ) {
+		return 0;
+	}
 
-		if ( 0 == strcmp(emsg->to.addr, myaddr->addr) ) {
-			sz = emsg->size;
-			tmp = (char *) malloc(sz * sizeof(char));
-			memcpy(tmp, (char *)(emsg+1), sz);
+	int dst = *(int *)(myaddr->addr);
+	int received = 0;
+	long copied = 0;
 
-			emulnet.buff[i] = emulnet.buff[emulnet.currbuffsize-1];
-			emulnet.currbuffsize--;
+	int drained = 0;
+	int reassembled = 0;
+	int expired = 0;
+	int decompressed = 0;
+	long nsec = 0;
+	auto &frames = box->second.frames;
+	int slot = WorkerPool::currentSlot();
 
-			(*enq)(queue, (char *)tmp, sz);
+	// Deliver in send order; only this node's own messages are touched
+	while ( !frames.empty() ) {
+		emsg = frames.front();
+		frames.pop();
 
-			free(emsg);
+		if ( emsg->frag ) {
+			drained++;
+			emsg = reassemble(box->second, emsg, copied);
+			if ( NULL == emsg ) {
+				continue;
+			}
+			reassembled++;
+		}
+		else {
+			drained += max(emsg->batch, 1);
+		}
 
-			int dst = *(int *)(myaddr->addr);
-			int time = par->getcurrtime();
+		if ( emsg->raw ) {
+			emsg = decompress(emsg, nsec);
+			if ( NULL == emsg ) {
+				continue;
+			}
+			decompressed++;
+		}
 
-			assert(dst <= MAX_NODES);
-			assert(time < MAX_TIME);
+		if ( 0 == emsg->batch ) {
+			en_part part;
+			part.size = emsg->size;
+			part.layer = emsg->layer;
+			part.type = emsg->type;
+			countReceived(slot, dst, part);
+			// the frame itself goes to the node queue, which releases it after handling
+			(*enq)(queue, (char *)(emsg + 1), emsg->size);
+			received++;
+			continue;
+		}
 
-			recv_msgs[dst][time]++;
+		// a packed frame is split back into one frame per message
+		char *pos = (char *)(emsg + 1);
+		for ( int i = 0; i < emsg->batch; i++ ) {
+			en_part part;
+			memcpy(&part, pos, sizeof(en_part));
+			char *data = ENgetFrame(part.size, part.layer, part.type);
+			memcpy(data, pos + sizeof(en_part), part.size);
+			pos += sizeof(en_part) + part.size;
+			countReceived(slot, dst, part);
+			(*enq)(queue, data, part.size);
+		}
+		received += emsg->batch;
+		copied += emsg->size;
+		FramePool::release(emsg);
+	}
+
+	// messages that lost a fragment are given up after FRAG_TIMEOUT ticks
+	unordered_map<unsigned long long, en_reasm> &partial = box->second.partial;
+	for ( auto it = partial.begin(); it != partial.end(); ) {
+		if ( par->getcurrtime() - it->second.firstTick > par->FRAG_TIMEOUT ) {
+			FramePool::release(it->second.frame);
+			it = partial.erase(it);
+			expired++;
+		}
+		else {
+			++it;
+		}
+	}
+
+	if ( 0 == drained && 0 == expired ) {
+		return 0;
+	}
+
+	// the shared counters are only touched outside of a parallel phase
+	if ( slot >= 0 ) {
+		if ( received > 0 ) {
+			slots[slot].received.push_back(make_pair(dst, received));
+		}
+		slots[slot].drained += drained;
+		slots[slot].copiedBytes += copied;
+		slots[slot].reassembled += reassembled;
+		slots[slot].expired += expired;
+		slots[slot].decompressed += decompressed;
+		slots[slot].decompressNsec += nsec;
+	}
+	else {
+		copiedBytes += copied;
+		emulnet.currbuffsize -= drained;
+		deliveredMsgs += received;
+		reassembledMsgs += reassembled;
+		expiredMsgs += expired;
+		decompressedFrames += decompressed;
+		decompressNsec += nsec;
+		if ( received > 0 ) {
+			countMsg(recv_msgs, dst, par->getcurrtime(), received);
 		}
 	}
 
 	return 0;
 }
 
+/**
+ * FUNCTION NAME: countMsg
+ *
+ * DESCRIPTION: Count messages of node at time. A node's row is created the
+ * 				first time it sends or receives and grows with the run.
+ */
+void EmulNet::countMsg(vector<vector<int> > &counters, int node, int time, int count) {
+	if ( node >= (int)counters.size() ) {
+		counters.resize(node + 1);
+	}
+	vector<int> &row = counters[node];
+	if ( time >= (int)row.size() ) {
+		row.resize(time + 1, 0);
+	}
+	row[time] += count;
+}
+
+/**
+ * FUNCTION NAME: msgCount
+ *
+ * DESCRIPTION: Messages counted for node at time, 0 when nothing was counted
+ */
+int EmulNet::msgCount(const vector<vector<int> > &counters, int node, int time) {
+	if ( node >= (int)counters.size() || time >= (int)counters[node].size() ) {
+		return 0;
+	}
+	return counters[node][time];
+}
+
+/**
+ * FUNCTION NAME: trafficIndex
+ *
+ * DESCRIPTION: Entry of traffic for a layer and message type. Out of range tags
+ * 				are counted as untagged.
+ */
+int EmulNet::trafficIndex(int layer, int type) {
+	if ( layer < 0 || layer >= EN_LAYERS || type < 0 || type >= EN_MAX_TYPES ) {
+		return 0;
+	}
+	return layer * EN_MAX_TYPES + type;
+}
+
+/**
+ * FUNCTION NAME: countTraffic
+ *
+ * DESCRIPTION: Count one message of bytes payload bytes, sent or received by node
+ * 				at time, against its message type
+ */
+void EmulNet::countTraffic(bool sent, int node, int time, int layer, int type, int bytes) {
+	en_traffic &entry = traffic[trafficIndex(layer, type)];
+	countMsg(sent ? entry.sentMsgs : entry.recvMsgs, node, time, 1);
+	countMsg(sent ? entry.sentBytes : entry.recvBytes, node, time, bytes);
+}
+
+/**
+ * FUNCTION NAME: countReceived
+ *
+ * DESCRIPTION: Count a message handed to node. Inside a parallel phase it is kept
+ * 				in the slot until ENflush.
+ */
+void EmulNet::countReceived(int slot, int node, en_part &part) {
+	if ( slot >= 0 ) {
+		slots[slot].receivedParts.push_back(make_pair(node, part));
+	}
+	else {
+		countTraffic(false, node, par->getcurrtime(), part.layer, part.type, part.size);
+	}
+}
+
+/**
+ * FUNCTION NAME: rowTotal
+ *
+ * DESCRIPTION: Sum of the counters of node over the whole run
+ */
+long EmulNet::rowTotal(const vector<vector<int> > &counters, int node) {
+	long total = 0;
+	if ( node < (int)counters.size() ) {
+		for ( unsigned int t = 0; t < counters[node].size(); t++ ) {
+			total += counters[node][t];
+		}
+	}
+	return total;
+}
+
+/**
+ * FUNCTION NAME: trafficName
+ *
+ * DESCRIPTION: Layer and type name of an entry of traffic, as in "MP1 PING"
+ */
+string EmulNet::trafficName(int index) {
+	static const char *layerNames[EN_LAYERS] = {"-", "MP1", "MP2"};
+	string name = layerNames[index / EN_MAX_TYPES];
+	return name + " " + (typeNames[index].empty() ? "type " + to_string(index % EN_MAX_TYPES) : typeNames[index]);
+}
+
+/**
+ * FUNCTION NAME: writeStats
+ *
+ * DESCRIPTION: Append the section of this network to STATS_FILE: the sent, received
+ * 				and refused message counts, then the messages and bytes of every
+ * 				message type that went over the network
+ */
+void EmulNet::writeStats(int network) {
+	FILE *file = fopen(STATS_FILE, 0 == network ? "wb" : "ab");
+	if ( NULL == file ) {
+		return;
+	}
+
+	vector<pair<string, const vector<vector<int> > *> > columns;
+	columns.push_back(make_pair(string("sent"), &sent_msgs));
+	columns.push_back(make_pair(string("recv"), &recv_msgs));
+	columns.push_back(make_pair(string("full"), &full_msgs));
+	for ( int i = 0; i < (int)traffic.size(); i++ ) {
+		en_traffic &entry = traffic[i];
+		if ( entry.sentMsgs.empty() && entry.recvMsgs.empty() ) {
+			continue;
+		}
+		string name = trafficName(i);
+		columns.push_back(make_pair(name + " sent", &entry.sentMsgs));
+		columns.push_back(make_pair(name + " sent bytes", &entry.sentBytes));
+		columns.push_back(make_pair(name + " recv", &entry.recvMsgs));
+		columns.push_back(make_pair(name + " recv bytes", &entry.recvBytes));
+	}
+
+	st_header hdr;
+	hdr.version = STATS_VERSION;
+	hdr.network = network;
+	hdr.nodes = par->EN_GPSZ;
+	hdr.ticks = par->getcurrtime();
+	hdr.columns = columns.size();
+	StatsFile::writeHeader(file, &hdr);
+	for ( unsigned int c = 0; c < columns.size(); c++ ) {
+		StatsFile::writeColumn(file, columns[c].first.c_str(), *columns[c].second, hdr.nodes, hdr.ticks);
+	}
+	fclose(file);
+}
+
+/**
+ * FUNCTION NAME: writeTraffic
+ *
+ * DESCRIPTION: Tables of the traffic by message type for msgcount.log: totals of
+ * 				the run, then the bytes every node sent of each type. Types that
+ * 				never went over the network are left out.
+ */
+void EmulNet::writeTraffic(FILE *file) {
+	vector<int> used;
+	vector<string> names;
+	vector<long> sentBytes;
+	long allBytes = 0;
+
+	for ( int i = 0; i < (int)traffic.size(); i++ ) {
+		long msgs = 0;
+		long bytes = 0;
+		for ( int n = 0; n <= par->EN_GPSZ; n++ ) {
+			msgs += rowTotal(traffic[i].sentMsgs, n) + rowTotal(traffic[i].recvMsgs, n);
+			bytes += rowTotal(traffic[i].sentBytes, n);
+		}
+		if ( 0 == msgs ) {
+			continue;
+		}
+		used.push_back(i);
+		sentBytes.push_back(bytes);
+		allBytes += bytes;
+		string name = trafficName(i);
+		names.push_back(name);
+	}
+	if ( used.empty() ) {
+		return;
+	}
+
+	fprintf(file, "\ntraffic by message type   sent msgs    sent bytes   recv msgs    recv bytes  bytes/msg  share of sent bytes\n");
+	for ( unsigned int k = 0; k < used.size(); k++ ) {
+		en_traffic &entry = traffic[used[k]];
+		long sentMsgs = 0;
+		long recvMsgs = 0;
+		long recvBytes = 0;
+		for ( int n = 0; n <= par->EN_GPSZ; n++ ) {
+			sentMsgs += rowTotal(entry.sentMsgs, n);
+			recvMsgs += rowTotal(entry.recvMsgs, n);
+			recvBytes += rowTotal(entry.recvBytes, n);
+		}
+		fprintf(file, "%-24s %10ld %13ld %11ld %13ld %10.1f %6.1f%%\n", names[k].c_str(), sentMsgs, sentBytes[k], recvMsgs, recvBytes, sentMsgs > 0 ? (double)sentBytes[k] / sentMsgs : 0.0, allBytes > 0 ? 100.0 * sentBytes[k] / allBytes : 0.0);
+	}
+
+	fprintf(file, "\nsent bytes by node  ");
+	for ( unsigned int k = 0; k < used.size(); k++ ) {
+		fprintf(file, " %12s", names[k].c_str());
+	}
+	fprintf(file, "\n");
+	for ( int n = 1; n <= par->EN_GPSZ; n++ ) {
+		fprintf(file, "node %3d            ", n);
+		for ( unsigned int k = 0; k < used.size(); k++ ) {
+			fprintf(file, " %12ld", rowTotal(traffic[used[k]].sentBytes, n));
+		}
+		fprintf(file, "\n");
+	}
+}
+
+/**
+ * FUNCTION NAME: ENsetSlots
+ *
+ * DESCRIPTION: Prepare one outbox and one frame cache per WorkerPool slot
+ */
+void EmulNet::ENsetSlots(int count) {
+	slots.resize(count);
+	pool.setSlots(count);
+}
+
+/**
+ * FUNCTION NAME: ENflush
+ *
+ * DESCRIPTION: Apply what the slots did during the last parallel phase. Receives
+ * 				come first, then the outboxes are put on the network slot by slot,
+ * 				which is the order a serial pass over the nodes would have sent in.
+ *
+ * RETURNS:
+ * number of frames taken from the outboxes
+ */
+int EmulNet::ENflush() {
+	int time = par->getcurrtime();
+	int flushed = 0;
+
+	for ( unsigned int i = 0; i < slots.size(); i++ ) {
+		en_slot &slot = slots[i];
+		for ( unsigned int j = 0; j < slot.received.size(); j++ ) {
+			deliveredMsgs += slot.received[j].second;
+			countMsg(recv_msgs, slot.received[j].first, time, slot.received[j].second);
+		}
+		slot.received.clear();
+		for ( unsigned int j = 0; j < slot.receivedParts.size(); j++ ) {
+			en_part &part = slot.receivedParts[j].second;
+			countTraffic(false, slot.receivedParts[j].first, time, part.layer, part.type, part.size);
+		}
+		slot.receivedParts.clear();
+		emulnet.currbuffsize -= slot.drained;
+		copiedBytes += slot.copiedBytes;
+		reassembledMsgs += slot.reassembled;
+		expiredMsgs += slot.expired;
+		decompressedFrames += slot.decompressed;
+		decompressNsec += slot.decompressNsec;
+		slot.drained = 0;
+		slot.copiedBytes = 0;
+		slot.reassembled = 0;
+		slot.expired = 0;
+		slot.decompressed = 0;
+		slot.decompressNsec = 0;
+	}
+
+	for ( unsigned int i = 0; i < slots.size(); i++ ) {
+		en_slot &slot = slots[i];
+		for ( unsigned int j = 0; j < slot.outbox.size(); j++ ) {
+			deliver(slot.outbox[j].em, &slot.outbox[j].to);
+		}
+		flushed += slot.outbox.size();
+		slot.outbox.clear();
+	}
+
+	sealBatches();
+	pool.collect();
+
+	return flushed;
+}
+
 /**
  * FUNCTION NAME: ENcleanup
  *
  * DESCRIPTION: Cleanup the EmulNet. Called exactly once at the end of the program.
+ * 				The per node, per tick counters go to STATS_FILE; msgcount.log
+ * 				only lists them as well with STATS_TEXT.
  */
 int EmulNet::ENcleanup() {
+	// the nodes call it as well when they finish, only the first call counts
+	if ( cleanedUp ) {
+		return 0;
+	}
+	cleanedUp = true;
+
 	emulnet.nextid=0;
 	int i, j;
-	int sent_total, recv_total;
+	int sent_total, recv_total, full_total;
 
-	FILE* file = fopen("msgcount.log", "w+");
+	int network = cleanedUpNets++;
+	writeStats(network);
+	FILE* file = fopen("msgcount.log", 0 == network ? "w+" : "a");
+	fprintf(file, "network %d\n", network);
 
-	while(emulnet.currbuffsize > 0) {
-		free(emulnet.buff[--emulnet.currbuffsize]);
+	for ( auto &box : emulnet.inbox ) {
+		while ( !box.second.frames.empty() ) {
+			FramePool::release(box.second.frames.front());
+			box.second.frames.pop();
+		}
+		for ( auto &partial : box.second.partial ) {
+			FramePool::release(partial.second.frame);
+		}
+	}
+	emulnet.inbox.clear();
+	for ( unsigned int i = 0; i < wheel.size(); i++ ) {
+		for ( unsigned int j = 0; j < wheel[i].size(); j++ ) {
+			FramePool::release(wheel[i][j].em);
+		}
+		wheel[i].clear();
+	}
+	for ( unsigned int i = 0; i < batches.size(); i++ ) {
+		for ( unsigned int j = 0; j < batches[i].frames.size(); j++ ) {
+			FramePool::release(batches[i].frames[j]);
+		}
 	}
+	batches.clear();
+	for ( int i = 0; i < EN_LAYERS; i++ ) {
+		openBatch[i].clear();
+	}
+	emulnet.currbuffsize = 0;
 
 	for ( i = 1; i <= par->EN_GPSZ; i++ ) {
-		fprintf(file, "node %3d ", i);
+		if ( par->STATS_TEXT ) {
+			fprintf(file, "node %3d ", i);
+		}
 		sent_total = 0;
 		recv_total = 0;
+		full_total = 0;
 
 		for (j = 0; j < par->getcurrtime(); j++) {
 
-			sent_total += sent_msgs[i][j];
-			recv_total += recv_msgs[i][j];
-			if (i != 67) {
-				fprintf(file, " (%4d, %4d)", sent_msgs[i][j], recv_msgs[i][j]);
-				if (j % 10 == 9) {
-					fprintf(file, "\n         ");
-				}
+			int sent = msgCount(sent_msgs, i, j);
+			int recv = msgCount(recv_msgs, i, j);
+			sent_total += sent;
+			recv_total += recv;
+			full_total += msgCount(full_msgs, i, j);
+			if ( !par->STATS_TEXT ) {
+				continue;
 			}
-			else {
-				fprintf(file, "special %4d %4d %4d\n", j, sent_msgs[i][j], recv_msgs[i][j]);
+			fprintf(file, " (%4d, %4d)", sent, recv);
+			if (j % 10 == 9) {
+				fprintf(file, "\n         ");
 			}
 		}
+		if ( par->STATS_TEXT ) {
+			fprintf(file, "\n");
+		}
+		fprintf(file, "node %3d sent_total %6u  recv_total %6u\n", i, sent_total, recv_total);
+		if ( full_total > 0 ) {
+			fprintf(file, "node %3d buffer_full %6u\n", i, full_total);
+		}
 		fprintf(file, "\n");
-		fprintf(file, "node %3d sent_total %6u  recv_total %6u\n\n", i, sent_total, recv_total);
 	}
 
+	fprintf(file, "sends refused on a full buffer: %ld  (EN_BUFFSIZE %d)\n", fullMsgs, par->EN_BUFFSIZE);
+	fprintf(file, "bytes copied by EmulNet: %ld  delivered messages: %ld\n", copiedBytes, deliveredMsgs);
+	// every frame carries an en_msg header, a packed message also its size
+	long sentTotal = 0;
+	for ( unsigned int n = 0; n < sent_msgs.size(); n++ ) {
+		for ( unsigned int t = 0; t < sent_msgs[n].size(); t++ ) {
+			sentTotal += sent_msgs[n][t];
+		}
+	}
+	long overhead = sentFrames * (long)sizeof(en_msg) + packedMsgs * (long)sizeof(en_part);
+	fprintf(file, "frames: %ld for %ld messages (%ld packed, COALESCE %d)  frames/tick %.2f  header bytes/message %.2f\n", sentFrames, sentTotal, packedMsgs, par->COALESCE, par->getcurrtime() > 0 ? (double)sentFrames / par->getcurrtime() : 0.0, sentTotal > 0 ? (double)overhead / sentTotal : 0.0);
+	fprintf(file, "fragmented messages: %ld in %ld fragments (%ld dropped)  reassembled %ld  given up %ld  (FRAG_TIMEOUT %d)\n", fragmentedMsgs, sentFrags, droppedFrags, reassembledMsgs, expiredMsgs, par->FRAG_TIMEOUT);
+	fprintf(file, "compression: %ld of %ld frames compressed  payload bytes raw %ld  wire %ld (%.1f%%)  compress %.3f ms  decompressed %ld frames in %.3f ms  (COMPRESS %d, COMPRESS_MIN %d)\n", compressedFrames, compressTries, rawBytes, wireBytes, rawBytes > 0 ? 100.0 * wireBytes / rawBytes : 100.0, compressNsec / 1e6, decompressedFrames, decompressNsec / 1e6, par->COMPRESS, par->COMPRESS_MIN);
+	pool.collect();
+	fprintf(file, "frame pool: allocs %ld  recycled %ld  mallocs %ld  in_use %ld  peak_in_use %ld\n", pool.allocs, pool.recycled, pool.mallocs, pool.inUse, pool.peakInUse);
+	writeTraffic(file);
+
 	fclose(file);
 	return 0;
 }
@@ -7,49 +7,190 @@
 #ifndef _EMULNET_H_
 #define _EMULNET_H_
 
-#define MAX_NODES 1000
-#define MAX_TIME 3600
-#define ENBUFFSIZE 30000
+// ticks covered by one turn of the delivery timer wheel
+#define EN_WHEEL_SIZE 256
+// message types a layer may tag its frames with
+#define EN_MAX_TYPES 16
 
 #include "stdincludes.h"
 #include "Params.h"
 #include "Member.h"
+#include "FramePool.h"
+#include "WorkerPool.h"
+#include "LzCodec.h"
 
 using namespace std;
 
+// protocol layer that sent a frame, EN_LAYER_NONE for frames nobody tagged. It is
+// also the channel of the frame: several layers may share one EmulNet.
+enum enLAYER { EN_LAYER_NONE, EN_LAYER_MP1, EN_LAYER_MP2, EN_LAYERS };
+
 /**
  * Struct Name: en_msg
+ *
+ * DESCRIPTION: Header of a frame. A frame sent to several nodes is shared by all
+ * 				of them, so what differs per destination is kept in an en_hop.
  */
 typedef struct en_msg {
 	// Number of bytes after the class
 	int size;
 	// Source node
 	Address from;
+	// number of messages packed in the payload, 0 for a single message
+	int batch;
+	// 1 when the payload is an en_frag header and one piece of a larger message
+	int frag;
+	// payload size before compression, 0 when the payload is not compressed
+	int raw;
+	// layer and message type given to ENgetFrame, for the traffic accounting;
+	// ENrecv only hands a frame to the layer it is tagged with
+	int layer;
+	int type;
+}en_msg;
+
+/**
+ * Struct Name: en_part
+ *
+ * DESCRIPTION: Header of one message in a packed frame
+ */
+typedef struct en_part {
+	int size;
+	int layer;
+	int type;
+}en_part;
+
+/**
+ * Struct Name: en_traffic
+ *
+ * DESCRIPTION: Messages and payload bytes of one message type, per node and
+ * 				per tick, grown on demand like the other counters
+ */
+typedef struct en_traffic {
+	vector<vector<int> > sentMsgs;
+	vector<vector<int> > sentBytes;
+	vector<vector<int> > recvMsgs;
+	vector<vector<int> > recvBytes;
+}en_traffic;
+
+/**
+ * Struct Name: en_frag
+ *
+ * DESCRIPTION: Header of a fragment. Messages that do not fit MAX_MSG_SIZE are
+ * 				cut into count pieces of equal size, the last one shorter.
+ */
+typedef struct en_frag {
+	// numbers the fragmented messages of a network
+	int id;
+	int index;
+	int count;
+	// size of the whole message
+	int total;
+	// raw field of the whole message
+	int raw;
+}en_frag;
+
+/**
+ * Struct Name: en_reasm
+ *
+ * DESCRIPTION: A message whose fragments are still arriving
+ */
+typedef struct en_reasm {
+	// the whole message, filled in as the fragments arrive
+	en_msg *frame;
+	int received;
+	// tick of the first fragment, the message is given up FRAG_TIMEOUT ticks later
+	int firstTick;
+	en_reasm(): frame(NULL), received(0), firstTick(0) {}
+}en_reasm;
+
+/**
+ * Struct Name: en_inbox
+ *
+ * DESCRIPTION: What is waiting for one node. Only that node's ENrecv touches the
+ * 				reassembly buffers, keyed by (source id, fragment id).
+ */
+typedef struct en_inbox {
+	queue<en_msg *> frames;
+	unordered_map<unsigned long long, en_reasm> partial;
+}en_inbox;
+
+/**
+ * Struct Name: en_hop
+ *
+ * DESCRIPTION: One destination of a frame
+ */
+typedef struct en_hop {
+	en_msg *em;
 	// Destination node
 	Address to;
-}en_msg;
+	// first tick whose ENrecv may see the message
+	int due;
+}en_hop;
+
+/**
+ * Struct Name: en_batch
+ *
+ * DESCRIPTION: Frames sent on one link during a tick, put on the network as one
+ * 				packed frame by ENflush. The packed payload is an en_part followed
+ * 				by the bytes of each message, in send order.
+ */
+typedef struct en_batch {
+	vector<en_msg *> frames;
+	Address to;
+	// payload bytes of the packed frame
+	int bytes;
+	en_batch(): bytes(0) {}
+}en_batch;
+
+/**
+ * Struct Name: en_slot
+ *
+ * DESCRIPTION: What one worker slot did to the network during a parallel phase.
+ * 				Applied by ENflush, in slot order, once the phase is over.
+ */
+typedef struct en_slot {
+	// frames sent during the phase, in send order
+	vector<en_hop> outbox;
+	// (node, number of messages) handed to the nodes during the phase
+	vector<pair<int, int> > received;
+	// (node, message) of every message handed to the nodes, for the traffic accounting
+	vector<pair<int, en_part> > receivedParts;
+	// messages and fragments taken out of flight
+	long drained;
+	long copiedBytes;
+	long reassembled;
+	long expired;
+	long decompressed;
+	long decompressNsec;
+	en_slot(): drained(0), copiedBytes(0), reassembled(0), expired(0), decompressed(0), decompressNsec(0) {}
+}en_slot;
 
 /**
  * Class Name: EM
+ *
+ * DESCRIPTION: In-flight messages, kept in one FIFO inbox per destination
+ * 				address and channel so a receiver only walks its own messages
  */
 class EM {
 public:
 	int nextid;
 	int currbuffsize;
 	int firsteltindex;
-	en_msg* buff[ENBUFFSIZE];
+	unordered_map<unsigned long long, en_inbox> inbox;
 	EM() {}
 	EM& operator = (EM &anotherEM) {
 		this->nextid = anotherEM.getNextId();
 		this->currbuffsize = anotherEM.getCurrBuffSize();
 		this->firsteltindex = anotherEM.getFirstEltIndex();
-		int i = this->currbuffsize;
-		while (i > 0) {
-			this->buff[i] = anotherEM.buff[i];
-			i--;
-		}
+		this->inbox = anotherEM.inbox;
 		return *this;
 	}
+	// Pack the 6 address bytes and the channel into the inbox key
+	static unsigned long long key(Address *addr, int channel) {
+		unsigned long long k = 0;
+		memcpy(&k, addr->addr, sizeof(addr->addr));
+		return k | (unsigned long long)(channel & 0xff) << 48;
+	}
 	int getNextId() {
 		return nextid;
 	}
@@ -74,26 +215,109 @@ public:
 /**
  * CLASS NAME: EmulNet
  *
- * DESCRIPTION: This class defines an emulated network
+ * DESCRIPTION: This class defines an emulated network. The EN* calls are virtual
+ * 				so another transport can stand in for it under the same nodes.
  */
 class EmulNet
 { 	
-private:
+protected:
 	Params* par;
-	int sent_msgs[MAX_NODES + 1][MAX_TIME];
-	int recv_msgs[MAX_NODES + 1][MAX_TIME];
+	// drop decisions, only drawn from outside of parallel phases
+	Random rng;
+	// per node, per tick message counters, grown on demand
+	vector<vector<int> > sent_msgs;
+	vector<vector<int> > recv_msgs;
 	int enInited;
 	EM emulnet;
+	// frames in flight and frames held by the node queues
+	FramePool pool;
+	// payload bytes memcpy'd by EmulNet and messages handed to the nodes
+	long copiedBytes;
+	long deliveredMsgs;
+	// sends refused because EN_BUFFSIZE messages were already in flight
+	vector<vector<int> > full_msgs;
+	long fullMsgs;
+	// side effects of the current parallel phase, one entry per WorkerPool slot
+	vector<en_slot> slots;
+	// messages still on a link, in bucket due % EN_WHEEL_SIZE
+	vector<vector<en_hop> > wheel;
+	// tick at which a link has sent everything queued on it, by (source id, destination id)
+	unordered_map<unsigned long long, double> linkFreeAt;
+	// batches of the current tick in the order they were opened, and the open one of
+	// each link, by channel since a batch is delivered on a single channel
+	vector<en_batch> batches;
+	unordered_map<unsigned long long, int> openBatch[EN_LAYERS];
+	// frames put on the network and messages that travelled packed in one
+	long sentFrames;
+	long packedMsgs;
+	// fragmentation: messages cut up, fragments sent and lost, messages put back together or given up
+	int nextFragId;
+	long fragmentedMsgs;
+	long sentFrags;
+	long droppedFrags;
+	long reassembledMsgs;
+	long expiredMsgs;
+	// compression: frames of at least COMPRESS_MIN bytes and those that came out smaller,
+	// payload bytes put on the links before and after, time spent in the codec
+	long compressTries;
+	long compressedFrames;
+	long rawBytes;
+	long wireBytes;
+	long compressNsec;
+	long decompressedFrames;
+	long decompressNsec;
+	vector<char> codecBuf;
+	// traffic by message type, indexed by layer * EN_MAX_TYPES + type, and the type names
+	vector<en_traffic> traffic;
+	vector<string> typeNames;
+	// ENcleanup runs once per network; the first network to run it starts msgcount.log
+	bool cleanedUp;
+	static int cleanedUpNets;
+	int send(en_msg *em, Address *toaddr);
+	int deliver(en_msg *em, Address *toaddr);
+	void route(en_msg *em, Address *toaddr);
+	void fragment(en_msg *em, Address *toaddr);
+	en_msg *reassemble(en_inbox &box, en_msg *em, long &copied);
+	int fragChunk();
+	void compress(en_msg *em);
+	en_msg *decompress(en_msg *em, long &nsec);
+	static long nsecSince(struct timespec *start);
+	void coalesce(en_msg *em, Address *toaddr);
+	void sealBatch(en_batch &batch);
+	int sealBatches();
+	int linkDelay(en_msg *em, Address *toaddr);
+	static unsigned long long linkKey(Address *from, Address *to);
+	static void countMsg(vector<vector<int> > &counters, int node, int time, int count);
+	static int msgCount(const vector<vector<int> > &counters, int node, int time);
+	void countTraffic(bool sent, int node, int time, int layer, int type, int bytes);
+	static int trafficIndex(int layer, int type);
+	static long rowTotal(const vector<vector<int> > &counters, int node);
+	void countReceived(int slot, int node, en_part &part);
+	string trafficName(int index);
+	void writeTraffic(FILE *file);
+	void writeStats(int network);
 public:
  	EmulNet(Params *p);
  	EmulNet(EmulNet &anotherEmulNet);
  	EmulNet& operator = (EmulNet &anotherEmulNet);
  	virtual ~EmulNet();
-	void *ENinit(Address *myaddr, short port);
+	virtual void *ENinit(Address *myaddr, short port);
 	int ENsend(Address *myaddr, Address *toaddr, string data);
 	int ENsend(Address *myaddr, Address *toaddr, char *data, int size);
-	int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue);
-	int ENcleanup();
+	char *ENgetFrame(int size, int layer = EN_LAYER_NONE, int type = 0);
+	void ENnameType(int layer, int type, const char *name);
+	int ENmaxPayload();
+	virtual int ENsendFrame(Address *myaddr, Address *toaddr, char *data, int size);
+	virtual int ENsendMulti(Address *myaddr, vector<Address> &toList, char *data, int size);
+	virtual int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue, int channel);
+	virtual int ENcleanup();
+	virtual int ENtick();
+	void ENsetSlots(int count);
+	virtual int ENflush();
+	// Pooled frame that holds a payload handed out by ENrecv or ENgetFrame
+	static void *ENframeOf(char *data) {
+		return (en_msg *)data - 1;
+	}
 };
 
 #endif /* _EMULNET_H_ */
@@ -0,0 +1,283 @@
+/**********************************
+ * FILE NAME: FramePool.cpp
+ *
+ * DESCRIPTION: Definition of the FramePool class
+ **********************************/
+
+#include "FramePool.h"
+#include "WorkerPool.h"
+
+/**
+ * Constructor
+ */
+FramePool::FramePool(): allocs(0), recycled(0), mallocs(0), inUse(0), peakInUse(0) {
+	for ( int i = 0; i < FP_NUM_CLASSES; i++ ) {
+		freeList[i] = NULL;
+	}
+}
+
+/**
+ * Copy constructor
+ *
+ * Slabs are owned by exactly one pool, so a copy starts out empty. Blocks of the
+ * other pool still go back to it on release().
+ */
+FramePool::FramePool(const FramePool &anotherPool): allocs(0), recycled(0), mallocs(0), inUse(0), peakInUse(0) {
+	for ( int i = 0; i < FP_NUM_CLASSES; i++ ) {
+		freeList[i] = NULL;
+	}
+}
+
+/**
+ * Assignment operator overloading
+ */
+FramePool& FramePool::operator =(const FramePool &anotherPool) {
+	return *this;
+}
+
+/**
+ * Destructor
+ */
+FramePool::~FramePool() {
+	for ( unsigned int i = 0; i < slabs.size(); i++ ) {
+		free(slabs[i]);
+	}
+}
+
+/**
+ * FUNCTION NAME: blockSize
+ *
+ * DESCRIPTION: Usable bytes of a block in the given size class
+ */
+int FramePool::blockSize(int sizeClass) {
+	return FP_MIN_BLOCK << sizeClass;
+}
+
+/**
+ * FUNCTION NAME: carveSlab
+ *
+ * DESCRIPTION: Allocate one slab and thread all of its blocks onto the free list
+ */
+void FramePool::carveSlab(int sizeClass) {
+	int stride = sizeof(fp_hdr) + blockSize(sizeClass);
+	int count = FP_SLAB_SIZE / stride;
+	if ( count < 1 ) {
+		count = 1;
+	}
+	char *slab = (char *) malloc(count * stride);
+	mallocs++;
+	slabs.push_back(slab);
+	for ( int i = 0; i < count; i++ ) {
+		fp_hdr *hdr = (fp_hdr *)(slab + i * stride);
+		hdr->pool = this;
+		hdr->sizeClass = sizeClass;
+		// a free block stores the next free block in its data area
+		*(void **)(hdr + 1) = freeList[sizeClass];
+		freeList[sizeClass] = hdr + 1;
+	}
+}
+
+/**
+ * FUNCTION NAME: setSlots
+ *
+ * DESCRIPTION: Prepare one cache per WorkerPool slot
+ */
+void FramePool::setSlots(int count) {
+	fp_cache empty;
+	memset(&empty, 0, sizeof(empty));
+	caches.resize(count, empty);
+}
+
+/**
+ * FUNCTION NAME: collect
+ *
+ * DESCRIPTION: Fold the counters of the slot caches into the totals of the pool.
+ * 				Called between phases, when no slot is running.
+ */
+void FramePool::collect() {
+	lock_guard<mutex> guard(lock);
+	for ( unsigned int i = 0; i < caches.size(); i++ ) {
+		allocs += caches[i].allocs;
+		mallocs += caches[i].mallocs;
+		inUse += caches[i].inUse;
+		caches[i].allocs = 0;
+		caches[i].mallocs = 0;
+		caches[i].inUse = 0;
+	}
+	// every malloc call served exactly one alloc, the rest came off a free list
+	recycled = allocs - mallocs;
+	if ( inUse > peakInUse ) {
+		peakInUse = inUse;
+	}
+}
+
+/**
+ * FUNCTION NAME: cache
+ *
+ * RETURNS:
+ * cache of the slot the calling thread runs, NULL outside a phase
+ */
+fp_cache *FramePool::cache() {
+	int slot = WorkerPool::currentSlot();
+	if ( slot < 0 || slot >= (int)caches.size() ) {
+		return NULL;
+	}
+	return &caches[slot];
+}
+
+/**
+ * FUNCTION NAME: refill
+ *
+ * DESCRIPTION: Move up to FP_BATCH blocks of a size class from the shared free
+ * 				list to the slot cache, carving a slab if the shared list is empty
+ */
+void FramePool::refill(fp_cache *slot, int sizeClass) {
+	lock_guard<mutex> guard(lock);
+	if ( NULL == freeList[sizeClass] ) {
+		carveSlab(sizeClass);
+	}
+	for ( int i = 0; i < FP_BATCH && freeList[sizeClass]; i++ ) {
+		void *buf = freeList[sizeClass];
+		freeList[sizeClass] = *(void **)buf;
+		*(void **)buf = slot->freeList[sizeClass];
+		slot->freeList[sizeClass] = buf;
+		slot->length[sizeClass]++;
+	}
+}
+
+/**
+ * FUNCTION NAME: spill
+ *
+ * DESCRIPTION: Move FP_BATCH blocks of a size class from the slot cache back to
+ * 				the shared free list, so a slot that mostly releases what others
+ * 				allocated does not hoard blocks
+ */
+void FramePool::spill(fp_cache *slot, int sizeClass) {
+	lock_guard<mutex> guard(lock);
+	for ( int i = 0; i < FP_BATCH; i++ ) {
+		void *buf = slot->freeList[sizeClass];
+		slot->freeList[sizeClass] = *(void **)buf;
+		slot->length[sizeClass]--;
+		*(void **)buf = freeList[sizeClass];
+		freeList[sizeClass] = buf;
+	}
+}
+
+/**
+ * FUNCTION NAME: allocOversized
+ *
+ * DESCRIPTION: malloc a block too big for any size class
+ */
+void *FramePool::allocOversized(int size) {
+	fp_hdr *hdr = (fp_hdr *) malloc(sizeof(fp_hdr) + size);
+	hdr->pool = this;
+	hdr->sizeClass = -1;
+	hdr->refs = 1;
+	return hdr + 1;
+}
+
+/**
+ * FUNCTION NAME: alloc
+ *
+ * DESCRIPTION: Hand out a block of at least size bytes. Inside a phase it comes
+ * 				from the cache of the calling slot.
+ *
+ * RETURNS:
+ * pointer to the usable bytes of the block
+ */
+void *FramePool::alloc(int size) {
+	int sizeClass = 0;
+	while ( sizeClass < FP_NUM_CLASSES && blockSize(sizeClass) < size ) {
+		sizeClass++;
+	}
+
+	fp_cache *slot = cache();
+	if ( slot ) {
+		slot->allocs++;
+		slot->inUse++;
+		if ( sizeClass == FP_NUM_CLASSES ) {
+			slot->mallocs++;
+			return allocOversized(size);
+		}
+		if ( NULL == slot->freeList[sizeClass] ) {
+			refill(slot, sizeClass);
+		}
+		void *buf = slot->freeList[sizeClass];
+		slot->freeList[sizeClass] = *(void **)buf;
+		slot->length[sizeClass]--;
+		((fp_hdr *)buf - 1)->refs = 1;
+		return buf;
+	}
+
+	lock_guard<mutex> guard(lock);
+	allocs++;
+	if ( ++inUse > peakInUse ) {
+		peakInUse = inUse;
+	}
+
+	if ( sizeClass == FP_NUM_CLASSES ) {
+		mallocs++;
+		return allocOversized(size);
+	}
+
+	if ( NULL == freeList[sizeClass] ) {
+		carveSlab(sizeClass);
+	}
+	else {
+		recycled++;
+	}
+	void *buf = freeList[sizeClass];
+	freeList[sizeClass] = *(void **)buf;
+	((fp_hdr *)buf - 1)->refs = 1;
+	return buf;
+}
+
+/**
+ * FUNCTION NAME: retain
+ *
+ * DESCRIPTION: Register one more holder of the block
+ */
+void FramePool::retain(void *buf) {
+	__atomic_add_fetch(&((fp_hdr *)buf - 1)->refs, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * FUNCTION NAME: release
+ *
+ * DESCRIPTION: Drop one holder of the block. The last holder gives it back to
+ * 				the pool it came from, to the cache of the calling slot inside a
+ * 				phase.
+ */
+void FramePool::release(void *buf) {
+	if ( NULL == buf ) {
+		return;
+	}
+	fp_hdr *hdr = (fp_hdr *)buf - 1;
+	if ( __atomic_sub_fetch(&hdr->refs, 1, __ATOMIC_ACQ_REL) > 0 ) {
+		return;
+	}
+	FramePool *pool = hdr->pool;
+	fp_cache *slot = pool->cache();
+	if ( slot ) {
+		slot->inUse--;
+		if ( hdr->sizeClass < 0 ) {
+			free(hdr);
+			return;
+		}
+		*(void **)buf = slot->freeList[hdr->sizeClass];
+		slot->freeList[hdr->sizeClass] = buf;
+		if ( ++slot->length[hdr->sizeClass] > 2 * FP_BATCH ) {
+			pool->spill(slot, hdr->sizeClass);
+		}
+		return;
+	}
+
+	lock_guard<mutex> guard(pool->lock);
+	pool->inUse--;
+	if ( hdr->sizeClass < 0 ) {
+		free(hdr);
+		return;
+	}
+	*(void **)buf = pool->freeList[hdr->sizeClass];
+	pool->freeList[hdr->sizeClass] = buf;
+}
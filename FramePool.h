@@ -0,0 +1,101 @@
+/**********************************
+ * FILE NAME: FramePool.h
+ *
+ * DESCRIPTION: Size-classed slab allocator for EmulNet frames
+ **********************************/
+
+#ifndef FRAMEPOOL_H_
+#define FRAMEPOOL_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// smallest block size in bytes, every next class doubles it
+#define FP_MIN_BLOCK 64
+// 64, 128, ..., 4096 bytes; anything bigger is malloc'ed directly
+#define FP_NUM_CLASSES 7
+// bytes carved into blocks at once when a class runs dry
+#define FP_SLAB_SIZE 65536
+// blocks moved at once between a slot cache and the shared free lists
+#define FP_BATCH 32
+
+class FramePool;
+
+/**
+ * STRUCT NAME: fp_hdr
+ *
+ * DESCRIPTION: Header in front of every pooled block. Remembers the owning pool
+ * 				so a block can be handed back from anywhere, and counts the holders
+ * 				of the block so one frame can be read in place by several owners.
+ */
+typedef struct fp_hdr {
+	FramePool *pool;
+	// index of the size class, -1 for an oversized block
+	int sizeClass;
+	// number of holders, the block is recycled when it drops to zero
+	int refs;
+}fp_hdr;
+
+/**
+ * STRUCT NAME: fp_cache
+ *
+ * DESCRIPTION: Free blocks and counters of one WorkerPool slot. Only the thread
+ * 				running the slot touches it during a phase, so it needs no lock.
+ */
+typedef struct fp_cache {
+	void *freeList[FP_NUM_CLASSES];
+	int length[FP_NUM_CLASSES];
+	long allocs;
+	// oversized blocks malloc'ed by the slot
+	long mallocs;
+	// blocks handed out less blocks given back, may go below zero
+	long inUse;
+}fp_cache;
+
+/**
+ * CLASS NAME: FramePool
+ *
+ * DESCRIPTION: Recycles message buffers through one free list per size class.
+ * 				Blocks are carved out of slabs that live until the pool is destroyed.
+ * 				Inside a parallel phase every WorkerPool slot allocates from and
+ * 				releases to a cache of its own, which refills from and spills to
+ * 				the shared free lists FP_BATCH blocks at a time under the mutex.
+ * 				Outside a phase the shared free lists are used directly. The holder
+ * 				counts are atomic since a frame may be shared between inboxes.
+ */
+class FramePool {
+private:
+	mutex lock;
+	void *freeList[FP_NUM_CLASSES];
+	vector<char *> slabs;
+	vector<fp_cache> caches;
+	void carveSlab(int sizeClass);
+	fp_cache *cache();
+	void refill(fp_cache *slot, int sizeClass);
+	void spill(fp_cache *slot, int sizeClass);
+	void *allocOversized(int size);
+public:
+	// blocks handed out
+	long allocs;
+	// blocks that came off a free list instead of fresh memory
+	long recycled;
+	// malloc calls made by the pool (slabs and oversized blocks)
+	long mallocs;
+	long inUse;
+	// highest inUse seen between phases
+	long peakInUse;
+	FramePool();
+	FramePool(const FramePool &anotherPool);
+	FramePool& operator =(const FramePool &anotherPool);
+	virtual ~FramePool();
+	void setSlots(int count);
+	void collect();
+	void *alloc(int size);
+	static void retain(void *buf);
+	static void release(void *buf);
+	static int blockSize(int sizeClass);
+};
+
+#endif /* FRAMEPOOL_H_ */
@@ -36,21 +36,27 @@ Log& Log::operator = (const Log& anotherLog) {
  */
 Log::~Log() {}
 
+/*
+ * Log files, opened by the first LOG call
+ */
+static FILE *fp;
+static FILE *fp2;
+
 /**
  * FUNCTION NAME: LOG
  *
  * DESCRIPTION: Print out to file dbg.log, along with Address of node.
+ * 				Inside a parallel phase the line is kept in the buffer of the
+ * 				worker slot and written by flush().
  */
 void Log::LOG(Address *addr, const char * str, ...) {
 
-	static FILE *fp;
-	static FILE *fp2;
 	va_list vararglist;
-	static char buffer[30000];
+	char buffer[30000];
 	static int numwrites;
-	static char stdstring[30];
-	static char stdstring2[40];
-	static char stdstring3[40]; 
+	char stdstring[30] = "";
+	char stdstring2[40];
+	char stdstring3[40]; 
 	static int dbg_opened=0;
 
 	if(dbg_opened != 639){
@@ -73,9 +79,22 @@ void Log::LOG(Address *addr, const char * str, ...) {
 	sprintf(stdstring, "%d.%d.%d.%d:%d ", addr->addr[0], addr->addr[1], addr->addr[2], addr->addr[3], *(short *)&addr->addr[4]);
 
 	va_start(vararglist, str);
-	vsprintf(buffer, str, vararglist);
+	int length = vsnprintf(buffer, sizeof(buffer), str, vararglist);
 	va_end(vararglist);
 
+	// lines that carry large values do not fit the stack buffer
+	string text;
+	if ( length >= (int)sizeof(buffer) ) {
+		text.resize(length + 1);
+		va_start(vararglist, str);
+		vsnprintf(&text[0], length + 1, str, vararglist);
+		va_end(vararglist);
+		text.resize(length);
+	}
+	else {
+		text = buffer;
+	}
+
 	if (!firstTime) {
 		int magicNumber = 0;
 		string magic = MAGIC_NUMBER;
@@ -87,18 +106,21 @@ void Log::LOG(Address *addr, const char * str, ...) {
 		firstTime = true;
 	}
 
-	if(memcmp(buffer, "#STATSLOG#", 10)==0){
-		fprintf(fp2, "\n %s", stdstring);
-		fprintf(fp2, "[%d] ", par->getcurrtime());
+	bool isStats = (memcmp(buffer, "#STATSLOG#", 10)==0);
+	string line = string("\n ") + stdstring + "[" + to_string(par->getcurrtime()) + "] " + text;
 
-		fprintf(fp2, buffer);
+	int slot = WorkerPool::currentSlot();
+	if ( slot >= 0 ) {
+		if ( isStats ) {
+			slots[slot].stats += line;
+		}
+		else {
+			slots[slot].dbg += line;
+		}
+		return;
 	}
-	else{
-		fprintf(fp, "\n %s", stdstring);
-		fprintf(fp, "[%d] ", par->getcurrtime());
-		fprintf(fp, buffer);
 
-	}
+	fputs(line.c_str(), isStats ? fp2 : fp);
 
 	if(++numwrites >= MAXWRITES){
 		fflush(fp);
@@ -108,13 +130,88 @@ void Log::LOG(Address *addr, const char * str, ...) {
 
 }
 
+/**
+ * FUNCTION NAME: print
+ *
+ * DESCRIPTION: Print a line of debug output to stdout. Inside a parallel phase
+ * 				the line is kept in the buffer of the worker slot and written by
+ * 				flush(), so the output does not depend on the number of threads.
+ */
+void Log::print(const char * str, ...) {
+	va_list vararglist;
+	char buffer[1024];
+
+	va_start(vararglist, str);
+	int length = vsnprintf(buffer, sizeof(buffer), str, vararglist);
+	va_end(vararglist);
+
+	string line;
+	if ( length >= (int)sizeof(buffer) ) {
+		line.resize(length + 1);
+		va_start(vararglist, str);
+		vsnprintf(&line[0], length + 1, str, vararglist);
+		va_end(vararglist);
+		line.resize(length);
+	}
+	else {
+		line = buffer;
+	}
+	line += "\n";
+
+	int slot = WorkerPool::currentSlot();
+	if ( slot >= 0 ) {
+		slots[slot].out += line;
+		return;
+	}
+	fputs(line.c_str(), stdout);
+}
+
+/**
+ * FUNCTION NAME: setSlots
+ *
+ * DESCRIPTION: Prepare one line buffer per WorkerPool slot
+ */
+void Log::setSlots(int count) {
+	slots.resize(count);
+}
+
+/**
+ * FUNCTION NAME: flush
+ *
+ * DESCRIPTION: Write the lines buffered during the last parallel phase, slot by
+ * 				slot, which is the order a serial pass over the nodes logs in
+ */
+void Log::flush() {
+	bool wrote = false;
+	for ( unsigned int i = 0; i < slots.size(); i++ ) {
+		if ( !slots[i].dbg.empty() ) {
+			fputs(slots[i].dbg.c_str(), fp);
+			slots[i].dbg.clear();
+			wrote = true;
+		}
+		if ( !slots[i].stats.empty() ) {
+			fputs(slots[i].stats.c_str(), fp2);
+			slots[i].stats.clear();
+			wrote = true;
+		}
+		if ( !slots[i].out.empty() ) {
+			fputs(slots[i].out.c_str(), stdout);
+			slots[i].out.clear();
+		}
+	}
+	if ( wrote ) {
+		fflush(fp);
+		fflush(fp2);
+	}
+}
+
 /**
  * FUNCTION NAME: logNodeAdd
  *
  * DESCRIPTION: To Log a node add
  */
 void Log::logNodeAdd(Address *thisNode, Address *addedAddr) {
-	static char stdstring[100];
+	char stdstring[100];
 	sprintf(stdstring, "Node %d.%d.%d.%d:%d joined at time %d", addedAddr->addr[0], addedAddr->addr[1], addedAddr->addr[2], addedAddr->addr[3], *(short *)&addedAddr->addr[4], par->getcurrtime());
     LOG(thisNode, stdstring);
 }
@@ -125,7 +222,7 @@ void Log::logNodeAdd(Address *thisNode, Address *addedAddr) {
  * DESCRIPTION: To log a node remove
  */
 void Log::logNodeRemove(Address *thisNode, Address *removedAddr) {
-	static char stdstring[30];
+	char stdstring[100];
 	sprintf(stdstring, "Node %d.%d.%d.%d:%d removed at time %d", removedAddr->addr[0], removedAddr->addr[1], removedAddr->addr[2], removedAddr->addr[3], *(short *)&removedAddr->addr[4], par->getcurrtime());
     LOG(thisNode, stdstring);
 }
@@ -136,14 +233,12 @@ void Log::logNodeRemove(Address *thisNode, Address *removedAddr) {
  * DESCRTION: Call this function after successfully create a key value pair
  */
 void Log::logCreateSuccess(Address * address, bool isCoordinator, int transID, string key, string value){
-	static char stdstring[100];
 	string str;
 	if (isCoordinator)
 		str = "coordinator";
 	else
 		str = "server";
-	sprintf(stdstring, "%s: create success at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), value.c_str());
-    LOG(address, stdstring);
+	LOG(address, "%s: create success at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), value.c_str());
 }
 
 /**
@@ -152,14 +247,12 @@ void Log::logCreateSuccess(Address * address, bool isCoordinator, int transID, s
  * DESCRIPTION: Call this function after successfully reading a key
  */
 void Log::logReadSuccess(Address * address, bool isCoordinator, int transID, string key, string value){
-    static char stdstring[100];
 	string str;
 	if (isCoordinator)
 		str = "coordinator";
 	else
 		str = "server";
-	sprintf(stdstring, "%s: read success at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), value.c_str());
-    LOG(address, stdstring);
+	LOG(address, "%s: read success at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), value.c_str());
 }
 
 /**
@@ -168,14 +261,12 @@ void Log::logReadSuccess(Address * address, bool isCoordinator, int transID, str
  * DESCRIPTION: Call this function after successfully updating a key
  */
 void Log::logUpdateSuccess(Address * address, bool isCoordinator, int transID, string key, string newValue){
-    static char stdstring[100];
 	string str;
 	if (isCoordinator)
 		str = "coordinator";
 	else
 		str = "server";
-	sprintf(stdstring, "%s: update success at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), newValue.c_str());
-    LOG(address, stdstring);
+	LOG(address, "%s: update success at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), newValue.c_str());
 }
 
 /**
@@ -184,14 +275,12 @@ void Log::logUpdateSuccess(Address * address, bool isCoordinator, int transID, s
  * DESCRIPTION: Call this function after successfully deleting a key
  */
 void Log::logDeleteSuccess(Address * address, bool isCoordinator, int transID, string key){
-    static char stdstring[100];
 	string str;
 	if (isCoordinator)
 		str = "coordinator";
 	else
 		str = "server";
-	sprintf(stdstring, "%s: delete success at time %d, transID=%d, key=%s", str.c_str(), par->getcurrtime(), transID, key.c_str());
-    LOG(address, stdstring);
+	LOG(address, "%s: delete success at time %d, transID=%d, key=%s", str.c_str(), par->getcurrtime(), transID, key.c_str());
 }
 
 /**
@@ -200,14 +289,12 @@ void Log::logDeleteSuccess(Address * address, bool isCoordinator, int transID, s
  * DESCRIPTION: Call this function if CREATE failed
  */
 void Log::logCreateFail(Address * address, bool isCoordinator, int transID, string key, string value){
-	static char stdstring[100];
 	string str;
 	if (isCoordinator)
 		str = "coordinator";
 	else
 		str = "server";
-	sprintf(stdstring, "%s: create fail at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), value.c_str());
-    LOG(address, stdstring);
+	LOG(address, "%s: create fail at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), value.c_str());
 }
 
 
@@ -217,14 +304,12 @@ void Log::logCreateFail(Address * address, bool isCoordinator, int transID, stri
  * DESCRIPTION: Call this function if READ failed
  */
 void Log::logReadFail(Address * address, bool isCoordinator, int transID, string key){
-    static char stdstring[100];
 	string str;
 	if (isCoordinator)
 		str = "coordinator";
 	else
 		str = "server";
-	sprintf(stdstring, "%s: read fail at time %d, transID=%d, key=%s", str.c_str(), par->getcurrtime(), transID, key.c_str());
-    LOG(address, stdstring);
+	LOG(address, "%s: read fail at time %d, transID=%d, key=%s", str.c_str(), par->getcurrtime(), transID, key.c_str());
 }
 
 /**
@@ -233,14 +318,12 @@ void Log::logReadFail(Address * address, bool isCoordinator, int transID, string
  * DESCRIPTION: Call this function if UPDATE failed
  */
 void Log::logUpdateFail(Address * address, bool isCoordinator, int transID, string key, string newValue){
-    static char stdstring[100];
 	string str;
 	if (isCoordinator)
 		str = "coordinator";
 	else
 		str = "server";
-	sprintf(stdstring, "%s: update fail at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), newValue.c_str());
-    LOG(address, stdstring);
+	LOG(address, "%s: update fail at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), newValue.c_str());
 }
 
 /**
@@ -249,12 +332,10 @@ void Log::logUpdateFail(Address * address, bool isCoordinator, int transID, stri
  * DESCRIPTION: Call this function if DELETE failed
  */
 void Log::logDeleteFail(Address * address, bool isCoordinator, int transID, string key){
-    static char stdstring[100];
 	string str;
 	if (isCoordinator)
 		str = "coordinator";
 	else
 		str = "server";
-	sprintf(stdstring, "%s: delete fail at time %d, transID=%d, key=%s", str.c_str(), par->getcurrtime(), transID, key.c_str());
-    LOG(address, stdstring);
+	LOG(address, "%s: delete fail at time %d, transID=%d, key=%s", str.c_str(), par->getcurrtime(), transID, key.c_str());
 }
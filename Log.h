@@ -10,6 +10,7 @@
 #include "stdincludes.h"
 #include "Params.h"
 #include "Member.h"
+#include "WorkerPool.h"
 
 /*
  * Macros
@@ -20,6 +21,18 @@
 #define DBG_LOG "dbg.log"
 #define STATS_LOG "stats.log"
 
+/**
+ * STRUCT NAME: log_slot
+ *
+ * DESCRIPTION: Lines logged by one worker slot during a parallel phase
+ */
+typedef struct log_slot {
+	string dbg;
+	string stats;
+	// lines for stdout
+	string out;
+}log_slot;
+
 /**
  * CLASS NAME: Log
  *
@@ -29,12 +42,16 @@ class Log{
 private:
 	Params *par;
 	bool firstTime;
+	vector<log_slot> slots;
 public:
 	Log(Params *p);
 	Log(const Log &anotherLog);
 	Log& operator = (const Log &anotherLog);
 	virtual ~Log();
 	void LOG(Address *, const char * str, ...);
+	void print(const char * str, ...);
+	void setSlots(int count);
+	void flush();
 	void logNodeAdd(Address *, Address *);
 	void logNodeRemove(Address *, Address *);
 	// success
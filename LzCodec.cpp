@@ -0,0 +1,192 @@
+/**********************************
+ * FILE NAME: LzCodec.cpp
+ *
+ * DESCRIPTION: Definition of the LzCodec class
+ **********************************/
+
+#include "LzCodec.h"
+
+/**
+ * FUNCTION NAME: compress
+ *
+ * DESCRIPTION: Compress size bytes of src into dst. Matches are found through a
+ * 				hash table of the last position each 4-byte prefix was seen at.
+ *
+ * RETURNS:
+ * compressed size, 0 if it does not fit in capacity bytes
+ */
+int LzCodec::compress(const char *src, int size, char *dst, int capacity) {
+	const unsigned char *in = (const unsigned char *)src;
+	unsigned char *out = (unsigned char *)dst;
+	int table[1 << LZ_HASH_BITS];
+	int pos = 0;
+	int anchor = 0;
+	int ip = 0;
+
+	for ( int i = 0; i < (1 << LZ_HASH_BITS); i++ ) {
+		table[i] = -1;
+	}
+
+	while ( ip + LZ_MIN_MATCH <= size ) {
+		unsigned int prefix;
+		memcpy(&prefix, in + ip, sizeof(prefix));
+		int hash = (prefix * 2654435761u) >> (32 - LZ_HASH_BITS);
+		int ref = table[hash];
+		table[hash] = ip;
+
+		if ( ref < 0 || ip - ref > LZ_MAX_OFFSET || 0 != memcmp(in + ref, in + ip, LZ_MIN_MATCH) ) {
+			ip++;
+			continue;
+		}
+
+		int length = LZ_MIN_MATCH;
+		while ( ip + length < size && in[ref + length] == in[ip + length] ) {
+			length++;
+		}
+		if ( !putSequence(out, pos, capacity, in + anchor, ip - anchor, ip - ref, length) ) {
+			return 0;
+		}
+		ip += length;
+		anchor = ip;
+	}
+
+	if ( !putSequence(out, pos, capacity, in + anchor, size - anchor, 0, 0) ) {
+		return 0;
+	}
+	return pos;
+}
+
+/**
+ * FUNCTION NAME: decompress
+ *
+ * DESCRIPTION: Expand what compress wrote into dst. Every length and offset is
+ * 				checked, so a damaged payload cannot write out of dst.
+ *
+ * RETURNS:
+ * decompressed size, -1 if src is not valid compressed data
+ */
+int LzCodec::decompress(const char *src, int size, char *dst, int capacity) {
+	const unsigned char *in = (const unsigned char *)src;
+	unsigned char *out = (unsigned char *)dst;
+	int ip = 0;
+	int op = 0;
+
+	while ( ip < size ) {
+		int token = in[ip++];
+
+		int literals = token >> 4;
+		if ( 15 == literals ) {
+			int more;
+			do {
+				if ( ip >= size ) {
+					return -1;
+				}
+				more = in[ip++];
+				literals += more;
+			} while ( 255 == more );
+		}
+		if ( literals > size - ip || literals > capacity - op ) {
+			return -1;
+		}
+		memcpy(out + op, in + ip, literals);
+		ip += literals;
+		op += literals;
+
+		// the last sequence ends with its literals
+		if ( ip == size ) {
+			break;
+		}
+
+		if ( size - ip < 2 ) {
+			return -1;
+		}
+		int offset = in[ip] | (in[ip + 1] << 8);
+		ip += 2;
+		if ( 0 == offset || offset > op ) {
+			return -1;
+		}
+
+		int length = (token & 15) + LZ_MIN_MATCH;
+		if ( 15 + LZ_MIN_MATCH == length ) {
+			int more;
+			do {
+				if ( ip >= size ) {
+					return -1;
+				}
+				more = in[ip++];
+				length += more;
+			} while ( 255 == more );
+		}
+		if ( length > capacity - op ) {
+			return -1;
+		}
+		// byte by byte, a match may overlap the bytes it produces
+		for ( int i = 0; i < length; i++, op++ ) {
+			out[op] = out[op - offset];
+		}
+	}
+
+	return op;
+}
+
+/**
+ * FUNCTION NAME: putSequence
+ *
+ * DESCRIPTION: Write the literals and the match that follows them. A sequence
+ * 				without a match (offset 0) only ends the data.
+ *
+ * RETURNS:
+ * false if out has no room left
+ */
+bool LzCodec::putSequence(unsigned char *out, int &pos, int capacity, const unsigned char *literals, int literalCount, int offset, int matchLength) {
+	if ( pos >= capacity ) {
+		return false;
+	}
+	int matchCode = offset > 0 ? matchLength - LZ_MIN_MATCH : 0;
+	out[pos++] = (min(literalCount, 15) << 4) | min(matchCode, 15);
+
+	if ( literalCount >= 15 && !putLength(out, pos, capacity, literalCount - 15) ) {
+		return false;
+	}
+	if ( literalCount > capacity - pos ) {
+		return false;
+	}
+	memcpy(out + pos, literals, literalCount);
+	pos += literalCount;
+
+	if ( 0 == offset ) {
+		return true;
+	}
+	if ( capacity - pos < 2 ) {
+		return false;
+	}
+	out[pos++] = offset & 0xff;
+	out[pos++] = offset >> 8;
+	if ( matchCode >= 15 && !putLength(out, pos, capacity, matchCode - 15) ) {
+		return false;
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: putLength
+ *
+ * DESCRIPTION: Rest of a length that did not fit its nibble: 255 while more than
+ * 				254 is left, then the remainder
+ *
+ * RETURNS:
+ * false if out has no room left
+ */
+bool LzCodec::putLength(unsigned char *out, int &pos, int capacity, int length) {
+	while ( true ) {
+		if ( pos >= capacity ) {
+			return false;
+		}
+		if ( length < 255 ) {
+			out[pos++] = length;
+			return true;
+		}
+		out[pos++] = 255;
+		length -= 255;
+	}
+}
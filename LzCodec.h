@@ -0,0 +1,41 @@
+/**********************************
+ * FILE NAME: LzCodec.h
+ *
+ * DESCRIPTION: Small LZ77 codec for EmulNet payloads
+ **********************************/
+
+#ifndef LZCODEC_H_
+#define LZCODEC_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// shortest match worth a back reference
+#define LZ_MIN_MATCH 4
+// back references are 2 bytes
+#define LZ_MAX_OFFSET 65535
+// entries in the match finder hash table
+#define LZ_HASH_BITS 12
+
+/**
+ * CLASS NAME: LzCodec
+ *
+ * DESCRIPTION: Byte oriented LZ77 in the style of LZ4. The compressed data is a
+ * 				series of sequences, each a token byte (literal count in the high
+ * 				nibble, match length - LZ_MIN_MATCH in the low one, 15 meaning more
+ * 				length bytes follow), the literals, then a 2-byte little endian
+ * 				offset of the match. The last sequence is literals only. Both calls
+ * 				are stateless, so nodes of a parallel phase can use them at once.
+ */
+class LzCodec {
+private:
+	static bool putSequence(unsigned char *out, int &pos, int capacity, const unsigned char *literals, int literalCount, int offset, int matchLength);
+	static bool putLength(unsigned char *out, int &pos, int capacity, int length);
+public:
+	static int compress(const char *src, int size, char *dst, int capacity);
+	static int decompress(const char *src, int size, char *dst, int capacity);
+};
+
+#endif /* LZCODEC_H_ */
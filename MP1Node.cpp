@@ -25,6 +25,16 @@ MP1Node::MP1Node(Member *member, Params *params, EmulNet *emul, Log *log, Addres
 	this->log = log;
 	this->par = params;
 	this->memberNode->addr = *address;
+	this->rng = params->newRandom();
+	this->probeNext = 0;
+	this->health = 0;
+	this->backlogged = false;
+	this->nextProbeId = 0;
+
+	static const char *msgTypeNames[DUMMYLASTMSGTYPE] = {"JOINREQ", "JOINREP", "ACK", "PING", "PINGREQ", "GOSSIP", "NACK"};
+	for ( int i = 0; i < DUMMYLASTMSGTYPE; i++ ) {
+		emul->ENnameType(EN_LAYER_MP1, i, msgTypeNames[i]);
+	}
 }
 
 /**
@@ -43,7 +53,11 @@ int MP1Node::recvLoop() {
     	return false;
     }
     else {
-    	return emulNet->ENrecv(&(memberNode->addr), enqueueWrapper, NULL, 1, &(memberNode->mp1q));
+    	// what is still queued was not handled in an earlier tick
+    	if ( !memberNode->mp1q.empty() ) {
+    		backlogged = true;
+    	}
+    	return emulNet->ENrecv(&(memberNode->addr), enqueueWrapper, NULL, 1, &(memberNode->mp1q), EN_LAYER_MP1);
     }
 }
 
@@ -54,7 +68,7 @@ int MP1Node::recvLoop() {
  */
 int MP1Node::enqueueWrapper(void *env, char *buff, int size) {
 	Queue q;
-	return q.enqueue((queue<q_elt> *)env, (void *)buff, size);
+	return q.enqueue((queue<q_elt> *)env, (void *)buff, size, EmulNet::ENframeOf(buff));
 }
 
 /**
@@ -129,9 +143,9 @@ int MP1Node::initThisNode(Address *joinaddr) {
  * DESCRIPTION: Join the distributed system
  */
 int MP1Node::introduceSelfToGroup(Address *joinaddr) {
-	MessageHdr *msg;
+	char *msg;
 #ifdef DEBUGLOG
-    static char s[1024];
+    char s[1024];
 #endif
 
     if ( 0 == memcmp((char *)&(memberNode->addr.addr), (char *)&(joinaddr->addr), sizeof(memberNode->addr.addr))) {
@@ -142,25 +156,20 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
         memberNode->inGroup = true;
     }
     else {
-        size_t msgsize = sizeof(MessageHdr) + sizeof(joinaddr->addr) + sizeof(long)+sizeof(long)+ 1;
-        msg = (MessageHdr *) malloc(msgsize * sizeof(char));
-
-        // create JOINREQ message: format of data is {struct Address myaddr}
-        msg->msgType = JOINREQ;
-        long currtime=par->getcurrtime();
-        memcpy((char *)(msg+1), &memberNode->addr.addr, sizeof(memberNode->addr.addr));
-        memcpy((char *)(msg+1) + 1 + sizeof(memberNode->addr.addr), &memberNode->heartbeat, sizeof(long));
-        memcpy((char *)(msg+1) + 1 + sizeof(memberNode->addr.addr)+sizeof(long),&currtime,sizeof(long));
+        // create JOINREQ message: this node's address and its own entry
+        MemberWriter writer(scratch, WIRE_MAX_HEADER + WIRE_MAX_ENTRY, par->getcurrtime());
+        writer.putHeader(JOINREQ, 0, 0, &memberNode->addr, NULL, 0);
+        writer.putEntry(*memberNode->myPos, DELTA_JOIN);
+        int msgSize;
+        msg = finishMessage(JOINREQ, writer, &msgSize);
 
 #ifdef DEBUGLOG
         sprintf(s, "Trying to join...");
         log->LOG(&memberNode->addr, s);
 #endif
 
-        // send JOINREQ message to introducer member
-        emulNet->ENsend(&memberNode->addr, joinaddr, (char *)msg, msgsize);
-
-        free(msg);
+        // send JOINREQ message to introducer member, the frame is handed over to EmulNet
+        emulNet->ENsendFrame(&memberNode->addr, joinaddr, msg, msgSize);
     }
 
     return 1;
@@ -174,6 +183,15 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
  */
 int MP1Node::finishUpThisNode(){
     memberNode->memberList.clear();
+    memberNode->memberIndex.clear();
+    deltas.clear();
+    queued.clear();
+    removedMembers.clear();
+    probeList.clear();
+    probeNext = 0;
+    probes.clear();
+    suspicions.clear();
+    health = 0;
     memberNode->heartbeat = 0; 
     memberNode->pingCounter = TFAIL;
     // Cleanup the network 
@@ -214,12 +232,21 @@ void MP1Node::checkMessages() {
     void *ptr;
     int size;
 
+    // a backlog means this node is too slow to keep up, which its timeouts allow for
+    if ( backlogged ) {
+    	adjustHealth(1);
+    	backlogged = false;
+    }
+
     // Pop waiting messages from memberNode's mp1q
     while ( !memberNode->mp1q.empty() ) {
     	ptr = memberNode->mp1q.front().elt;
     	size = memberNode->mp1q.front().size;
+    	q_elt elt = memberNode->mp1q.front();
     	memberNode->mp1q.pop();
     	recvCallBack((void *)memberNode, (char *)ptr, size);
+    	// done with the frame, hand it back to EmulNet
+    	elt.release();
     }
     return;
 }
@@ -228,112 +255,35 @@ void MP1Node::checkMessages() {
  *
  * DESCRIPTION: Update the receivers membership list and send gossip message upon addition of a new member
  */
-void MP1Node::updateMemberList(MessageHdr*msg)
+void MP1Node::updateMemberList(const MemberListEntry &news)
 {
-    Address SenderAddress;
-    int id;
-	short port;
-    long heartbeat;
-    long timestamp;    
-    memcpy(&SenderAddress.addr, (char *)(msg + 1), sizeof(SenderAddress.addr));
-    memcpy(&heartbeat,(char *)(msg+1) + 1 + sizeof(SenderAddress.addr), sizeof(long));
-    memcpy(&timestamp,(char*)(msg+1)+ 1 + sizeof(SenderAddress.addr)+sizeof(long), sizeof(long));
-    memcpy(&id, &SenderAddress.addr[0], sizeof(int));
-	memcpy(&port, &SenderAddress.addr[4], sizeof(short));
-    size_t myPosIndex = std::distance(memberNode->memberList.begin(), memberNode->myPos);
-    bool exists=false;
-    for (auto it = memberNode->memberList.begin(); it != memberNode->memberList.end(); ++it)
+    MemberListEntry *known = findMember(news.id, news.port);
+    if (known)
     {
-        if (it->id==id&&it->port==port)
-        {
-            exists=true;
-            if(heartbeat>it->heartbeat)
-            {
-                it->setheartbeat(heartbeat);
-                it->settimestamp(par->getcurrtime());
-            }
-            break;
-        }
+        refreshMember(known, news);
     }
-    if(!exists)
+    else
     {
-        memberNode->memberList.push_back(MemberListEntry(id,port,heartbeat,par->getcurrtime()));
+        MemberListEntry added(news.id,news.port,news.heartbeat,par->getcurrtime());
+        addMember(added);
         #ifdef DEBUGLOG
-        log->logNodeAdd(&memberNode->addr, &SenderAddress);
+        Address addAddr=getAddr(news.id,news.port);
+        log->logNodeAdd(&memberNode->addr, &addAddr);
         #endif  
-        memberNode->myPos = memberNode->memberList.begin() + myPosIndex;           
+        queueDelta(added, DELTA_JOIN);
         //send GOSSIP with TTL=3 to 2 random nodes
-        int ttl=TTL;
-        bool AddOrUpdate=true;
-        size_t msgSize=sizeof(MessageHdr)+sizeof(int)+sizeof(MemberListEntry)+sizeof(bool);
-        MessageHdr* gossip =(MessageHdr*)malloc(msgSize*sizeof(char));
-        gossip->msgType=GOSSIP;
-        MemberListEntry entry{id,port,heartbeat,par->getcurrtime()};
-        memcpy((char*)(gossip+1), &ttl, sizeof(int));
-        memcpy((char*)(gossip+1)+sizeof(int), &entry, sizeof(MemberListEntry));
-        memcpy((char*)(gossip+1)+sizeof(int)+sizeof(MemberListEntry),&AddOrUpdate,sizeof(bool));
-        sendGossip(gossip,msgSize);
-        free(gossip);
+        gossipEntry(added);
     }
     return;
                  
 }
-//overload of the function above
-void MP1Node::updateMemberList(MessageHdr*msg, int size)
+//overload of the function above, for the entries of a PING, ACK, PINGREQ or NACK
+void MP1Node::updateMemberList(MemberReader &reader)
 {   
-    Address SenderAddress;
-    memcpy(&SenderAddress.addr, (char *)(msg + 1), sizeof(SenderAddress.addr));
-    size_t myPosIndex = std::distance(memberNode->memberList.begin(), memberNode->myPos);
-    char* ptr = (char*)(msg + 1);
-    ptr+=sizeof(memberNode->addr.addr)*2 + sizeof(bool);
-    while(ptr-(char*)msg<size)
-    {
-        MemberListEntry sendersEntry;
-        memcpy(&sendersEntry, ptr, sizeof(MemberListEntry));
-        ptr+=sizeof(MemberListEntry);
-        bool addOrupdate;
-        memcpy(&addOrupdate,ptr,sizeof(bool));
-        //move to the next memberListEntry
-        ptr += sizeof(bool);
-        if(addOrupdate)
-        {
-            bool exists = false;
-            for (auto it = memberNode->memberList.begin(); it != memberNode->memberList.end(); ++it)
-            {
-                if(it->id==sendersEntry.id&&it->port==sendersEntry.port)
-                {
-                    exists=true;
-                    if(sendersEntry.heartbeat>it->heartbeat)
-                    {
-                        it->setheartbeat(sendersEntry.heartbeat);
-                        it->settimestamp(par->getcurrtime());
-                    }
-                    break;
-                }
-            }
-            if(!exists)
-            {
-                memberNode->memberList.push_back(MemberListEntry(sendersEntry.id,sendersEntry.port,sendersEntry.heartbeat,par->getcurrtime()));
-                #ifdef DEBUGLOG
-                log->logNodeAdd(&memberNode->addr, &SenderAddress);
-                #endif
-                memberNode->myPos = memberNode->memberList.begin() + myPosIndex;
-                //send GOSSIP with TTL=3 to 2 random nodes
-                int ttl=TTL;
-                bool AddOrUpdate=true;
-                size_t msgSize=sizeof(MessageHdr)+sizeof(int)+sizeof(MemberListEntry)+sizeof(bool);
-                MessageHdr* gossip =(MessageHdr*)malloc(msgSize*sizeof(char));
-                gossip->msgType=GOSSIP;
-                MemberListEntry entry{sendersEntry.id,sendersEntry.port,sendersEntry.heartbeat,par->getcurrtime()};
-                memcpy((char*)(gossip+1), &ttl, sizeof(int));
-                memcpy((char*)(gossip+1)+sizeof(int), &entry, sizeof(MemberListEntry));
-                memcpy((char*)(gossip+1)+sizeof(int)+sizeof(MemberListEntry),&AddOrUpdate,sizeof(bool));
-                sendGossip(gossip,msgSize);
-                free(gossip);               
-            }
-            
-        }
-    }
+    MemberListEntry sendersEntry;
+    int kind;
+    while (reader.nextEntry(&sendersEntry, &kind))
+        applyDelta(sendersEntry, (char)kind);
 }
 /**
  * FUNCTION NAME: recvCallBack
@@ -341,372 +291,182 @@ void MP1Node::updateMemberList(MessageHdr*msg, int size)
  * DESCRIPTION: Message handler for different message types
  */
 bool MP1Node::recvCallBack(void *env, char *data, int size ) {
-	 MessageHdr *msg = (MessageHdr *)data;
-     switch (msg->msgType) {
+     WireHeader hdr;
+     MemberReader reader(data, size, par->getcurrtime());
+     //a message of another wire version, or cut short, is dropped
+     if (!reader.getHeader(&hdr))
+        return false;
+     MemberListEntry sendersEntry;
+     int kind;
+     switch (hdr.type) {
         /*node receives join request message, updates its membership list and sends a reply
         that contains the nodes own membership list*/
         case JOINREQ:{
-            Address SenderAddress;
-            memcpy(&SenderAddress.addr,(char*)(msg+1), sizeof(SenderAddress.addr));
-            updateMemberList(msg);            
-            //preparing JOINREP msg
-            size_t actualSize = memberNode->memberList.size();
-            size_t listSize = std::min(actualSize, static_cast<size_t>(MAX_PARTIAL_LIST_SIZE)) * sizeof(MemberListEntry);
-            size_t msgSize = sizeof(MessageHdr) + sizeof(memberNode->addr.addr)+listSize;
-            MessageHdr *reply = (MessageHdr *)malloc(msgSize);
-            reply->msgType=JOINREP;
-            memcpy((char*)(reply+1), &memberNode->addr.addr, sizeof(memberNode->addr.addr));
-            memcpy((char*)(reply+1)+sizeof(SenderAddress.addr), memberNode->memberList.data(), listSize);
-            emulNet->ENsend(&memberNode->addr, &SenderAddress, (char *)reply, msgSize);
-            free(reply);
+            if (reader.nextEntry(&sendersEntry, &kind))
+                updateMemberList(sendersEntry);
+            //preparing JOINREP msg, the whole list since probes only carry what changed
+            MemberWriter writer(scratch, WIRE_MAX_HEADER + memberNode->memberList.size() * WIRE_MAX_ENTRY, par->getcurrtime());
+            writer.putHeader(JOINREP, 0, 0, &memberNode->addr, NULL, 0);
+            for (auto it = memberNode->memberList.begin(); it != memberNode->memberList.end(); ++it)
+                writer.putEntry(*it, DELTA_ALIVE);
+            int msgSize;
+            char *reply = finishMessage(JOINREP, writer, &msgSize);
+            emulNet->ENsendFrame(&memberNode->addr, &hdr.sender, reply, msgSize);
             break;
         }
         /*node receives join reply message, extracts the membership list and merges it with its own,
           sends gossip message about newly added entries to the membership list*/
         case JOINREP: {
-            Address SenderAddress;
-            memcpy(&SenderAddress.addr, (char *)(msg + 1), sizeof(SenderAddress.addr));
-            // Extract and process the member list from the JOINREP message
-            size_t listOffset = sizeof(SenderAddress.addr);
-            MemberListEntry *members = (MemberListEntry *)((char *)(msg + 1) + listOffset);//pointer to memberList.data()
-            size_t listSize = (size - sizeof(MessageHdr) - listOffset) / sizeof(MemberListEntry);
-            size_t myPosIndex = std::distance(memberNode->memberList.begin(), memberNode->myPos);
-            /* Here std::unordered_set may be used when merging two lists to reduce O(n2) complexity to O(n)
-            but I decided to maintain the existing style as this codebase uses heavy
-            C-style constructs */
-            for (size_t i = 0; i < listSize; ++i) 
+            //each entry is looked up in memberIndex, so the merge is linear in the size of the list
+            while (reader.nextEntry(&sendersEntry, &kind))
             {
-                bool exists=false;
-                for(auto it = memberNode->memberList.begin(); it != memberNode->memberList.end(); ++it)
+                MemberListEntry *known = findMember(sendersEntry.id, sendersEntry.port);
+                if (known)
                 {
-                    if(members[i].id==it->id&&members[i].port==it->port)
-                    {
-                        exists=true;
-                        if(members[i].heartbeat>it->heartbeat)
-                        {
-                            it->setheartbeat(members[i].heartbeat);
-                            it->settimestamp(par->getcurrtime());
-                        }
-                        break;
-                    }
+                    refreshMember(known, sendersEntry);
                 }
-                if(!exists)
+                else
                 {
-                  Address addr=getAddr(members[i].id,members[i].port);
-                  memberNode->memberList.push_back(members[i]);
+                  Address addr=getAddr(sendersEntry.id,sendersEntry.port);
+                  addMember(sendersEntry);
                   #ifdef DEBUGLOG
                   log->logNodeAdd(&memberNode->addr, &addr);
                   #endif
-                }                                                
+                }
             }
-            memberNode->myPos = memberNode->memberList.begin() + myPosIndex;
             memberNode->inGroup = true;
-            // Prepare a GOSSIP with TTL=3 to 2 random nodes 
-            size_t actualSize = memberNode->memberList.size();
-            size_t listsize = std::min(actualSize, static_cast<size_t>(MAX_PARTIAL_LIST_SIZE)); 
-            int ttl = TTL; 
-            bool AddOrUpdate = true; 
-            size_t msgSize = sizeof(MessageHdr) + sizeof(int) + sizeof(MemberListEntry) * listsize + sizeof(bool) * listsize; 
-            MessageHdr* gossip = (MessageHdr*)malloc(msgSize * sizeof(char)); 
-            gossip->msgType = GOSSIP; 
-            memcpy((char*)(gossip + 1), &ttl, sizeof(int)); 
-            char* ptr = (char*)(gossip + 1) + sizeof(int); 
-            auto it = memberNode->memberList.begin(); 
-            size_t remainingEntries = listsize; 
-            while (remainingEntries > 0 && it != memberNode->memberList.end()) 
-            { 
-                bool addOrupdate = true; 
-                // Check for valid memory bounds before memcpy 
-                if ((ptr + sizeof(MemberListEntry) + sizeof(bool)) <= ((char*)gossip + msgSize)) 
-                { 
-                memcpy(ptr, &*it, sizeof(MemberListEntry)); 
-                memcpy(ptr + sizeof(MemberListEntry), &addOrupdate, sizeof(bool)); 
-                ptr += sizeof(MemberListEntry) + sizeof(bool); 
-                } 
-                else 
-                {   // Handle potential memory overrun 
-                std::cerr << "Memory bounds exceeded while preparing GOSSIP message" << std::endl; 
-                free(gossip); 
-                } 
-                ++it; 
-                --remainingEntries; 
-            } 
-            sendGossip(gossip, msgSize); 
-            free(gossip);
+            // Prepare a GOSSIP with TTL=3 to 2 random nodes
+            size_t listsize = std::min(memberNode->memberList.size(), static_cast<size_t>(MAX_PARTIAL_LIST_SIZE));
+            MemberWriter writer(scratch, WIRE_MAX_HEADER + listsize * WIRE_MAX_ENTRY, par->getcurrtime());
+            writer.putHeader(GOSSIP, 0, TTL, &memberNode->addr, NULL, 0);
+            for (size_t i = 0; i < listsize; ++i)
+                writer.putEntry(memberNode->memberList[i], DELTA_ALIVE);
+            int msgSize;
+            char *gossip = finishMessage(GOSSIP, writer, &msgSize);
+            sendGossip(gossip, msgSize);
             #ifdef DEBUGLOG
             log->LOG(&memberNode->addr, "Joined the group...");
-            #endif            
+            #endif
             break;
         }
-         /* node checks the type of the received ping message direct or indirect ping, sends and ack 
+         /* node checks the type of the received ping message direct or indirect ping, sends and ack
          to the sender (SWIM protocol style message exchanging system) */
         case PING: {
-            Address SenderAddress;
-            memcpy(&SenderAddress.addr, (char *)(msg + 1), sizeof(SenderAddress.addr));
-            updateMemberList(msg,size); 
-            //extract the flag value
-            bool fromPingreq;
-            memcpy(&fromPingreq,(char *)(msg + 1)+sizeof(SenderAddress.addr),sizeof(bool));
-            if(fromPingreq)
-            {
-            //indirect PING
-            Address ackAddr;
-            memcpy(&ackAddr.addr,(char *)(msg + 1)+1+sizeof(SenderAddress.addr), sizeof(ackAddr.addr));
-            int countEntries=0;
-            for (auto it = memberNode->memberList.begin(); it != memberNode->memberList.end(); ++it)
-            {
-              if((par->getcurrtime()-it->timestamp)<=TFAIL)
-              ++countEntries;
-            }
-            size_t flagSize=countEntries*sizeof(char);
-            size_t listSize = static_cast<size_t>(countEntries) * sizeof(MemberListEntry);
-            //prepare a ACK message
-            size_t msgSize=sizeof(MessageHdr)+sizeof(memberNode->addr.addr)*2+listSize+1+flagSize;
-            MessageHdr* ack =(MessageHdr*)malloc(msgSize*sizeof(char));//allocation in bytes
-            ack ->msgType=ACK;
-            bool fromPingreq=true;
-            memcpy((char*)(ack +1), &memberNode->addr.addr, sizeof(memberNode->addr.addr));
-            memcpy((char*)(ack +1)+sizeof(memberNode->addr.addr),&fromPingreq,sizeof(bool));
-            memcpy((char*)(ack +1)+sizeof(memberNode->addr.addr)+1,&ackAddr.addr,sizeof(ackAddr.addr));
-            char* ptr = (char*)(ack  + 1) + sizeof(memberNode->addr.addr)*2 + sizeof(bool);
-            for (auto it = memberNode->memberList.begin(); it != memberNode->memberList.end(); ++it)
-            {
-               if ((par->getcurrtime() - it->timestamp) <= TFAIL)
-              { 
-                bool addOrupdate=true;
-                memcpy(ptr, &(*it), sizeof(MemberListEntry));
-                memcpy(ptr+sizeof(MemberListEntry),&addOrupdate,sizeof(bool));
-                ptr += sizeof(MemberListEntry)+sizeof(bool);
-              }        
-            }
-            emulNet->ENsend(&memberNode->addr, &SenderAddress, (char *)ack, msgSize);
-            free(ack);
-            }
-            else
-            {
-            //direct PING
-            int countEntries=0;
-            for (auto it = memberNode->memberList.begin(); it != memberNode->memberList.end(); ++it)
-            {
-              if((par->getcurrtime()-it->timestamp)<=TFAIL)
-              ++countEntries;
-            }
-            size_t flagSize=countEntries*sizeof(char);
-            size_t listSize = static_cast<size_t>(countEntries) * sizeof(MemberListEntry);
-            //prepare a ACK message
-            Address dummyAddr;
-            dummyAddr.init();    
-            size_t msgSize=sizeof(MessageHdr)+sizeof(memberNode->addr.addr)*2+listSize+1+flagSize;
-            MessageHdr* ack =(MessageHdr*)malloc(msgSize*sizeof(char));//allocation in bytes
-            ack ->msgType=ACK;
-            bool fromPingreq=false;
-            memcpy((char*)(ack +1), &memberNode->addr.addr, sizeof(memberNode->addr.addr));
-            memcpy((char*)(ack +1)+sizeof(memberNode->addr.addr),&fromPingreq,sizeof(bool));
-            memcpy((char*)(ack +1)+sizeof(memberNode->addr.addr)+1,&dummyAddr.addr,sizeof(dummyAddr.addr));
-            char* ptr = (char*)(ack  + 1) + sizeof(memberNode->addr.addr)*2 + sizeof(bool);
-            for (auto it = memberNode->memberList.begin(); it != memberNode->memberList.end(); ++it)
-            {
-               if ((par->getcurrtime() - it->timestamp) <= TFAIL)
-              { 
-                bool addOrupdate=true;
-                memcpy(ptr, &(*it), sizeof(MemberListEntry));
-                memcpy(ptr+sizeof(MemberListEntry),&addOrupdate,sizeof(bool));
-                ptr += sizeof(MemberListEntry)+sizeof(bool);
-              }        
-            }
-            emulNet->ENsend(&memberNode->addr, &SenderAddress, (char *)ack, msgSize);
-            free(ack);
-            }
+            updateMemberList(reader);
+            //an indirect PING names the node that asked for it, the ACK carries it back
+            //with the sequence id of the probe
+            bool fromPingreq = hdr.flags & WIRE_FROM_PINGREQ;
+            int msgSize;
+            char *ack = newProbe(ACK, fromPingreq, (hdr.flags & WIRE_HAS_OTHER) ? &hdr.other : NULL, hdr.seq, NULL, &msgSize);
+            emulNet->ENsendFrame(&memberNode->addr, &hdr.sender, ack, msgSize);
             break;
         }
          /* node receives acknowledge message, updates its membership list and sends a reply */
         case ACK: {
-            Address SenderAddress;//extract the senders address
-            memcpy(&SenderAddress.addr, (char *)(msg + 1), sizeof(SenderAddress.addr));
-            updateMemberList(msg,size);
-            //extract the flag value
-            bool fromPingreq;
-            memcpy(&fromPingreq,(char *)(msg + 1)+sizeof(SenderAddress.addr),sizeof(bool));
-            if(fromPingreq)
-            {
-            int countEntries=0;
-            for (auto it = memberNode->memberList.begin(); it != memberNode->memberList.end(); ++it)
-            {
-                if((par->getcurrtime()-it->timestamp)<=TFAIL)
-                ++countEntries;
-            }
-            //prepare an ACK
-            size_t flagSize=countEntries*sizeof(char);
-            size_t listSize = static_cast<size_t>(countEntries) * sizeof(MemberListEntry);
-            Address dummyAddr;
-            dummyAddr.init();
-            size_t msgSize=sizeof(MessageHdr)+sizeof(memberNode->addr.addr)*2+listSize+1+flagSize;
-            MessageHdr* ack =(MessageHdr*)malloc(msgSize*sizeof(char));//allocation in bytes
-            ack->msgType=ACK;
-            bool fromPingreq=false;
-            Address ackAddr;
-            memcpy(&ackAddr.addr,(char *)(msg + 1)+sizeof(SenderAddress.addr)+1,sizeof(ackAddr.addr));
-            memcpy((char*)(ack+1), &memberNode->addr.addr, sizeof(memberNode->addr.addr));
-            memcpy((char*)(ack+1)+sizeof(memberNode->addr.addr),&fromPingreq,sizeof(bool));
-            memcpy((char*)(ack+1)+sizeof(memberNode->addr.addr)+1,&dummyAddr.addr,sizeof(dummyAddr.addr));
-            char* ptr = (char*)(ack + 1) + sizeof(memberNode->addr.addr)*2+ sizeof(bool);
-            for (auto it = memberNode->memberList.begin(); it != memberNode->memberList.end(); ++it)
+            updateMemberList(reader);
+            int id;
+            short port;
+            memcpy(&id, &hdr.sender.addr[0], sizeof(int));
+            memcpy(&port, &hdr.sender.addr[4], sizeof(short));
+            //the other address is the requester of an indirect probe, or the probed node of a relayed ACK
+            if(hdr.flags & WIRE_FROM_PINGREQ)
             {
-                if ((par->getcurrtime() - it->timestamp) <= TFAIL)
-                { 
-                    bool addOrupdate=true;
-                    memcpy(ptr, &(*it), sizeof(MemberListEntry));
-                    memcpy(ptr+sizeof(MemberListEntry),&addOrupdate,sizeof(bool));
-                    ptr += sizeof(MemberListEntry)+sizeof(bool);
-                }        
-            }
-            emulNet->ENsend(&memberNode->addr, &ackAddr, (char *)ack, msgSize);
-            free(ack);
+            //pass the ACK on to the node that asked for the probe, with the entry of the probed node
+            MessageStatus *relay = findProbe(ACK, hdr.seq, &hdr.other);
+            if (!relay)
+                break;
+            relay->ackReceived = true;
+            relay->isActive = false;
+            int msgSize;
+            char *ack = newProbe(ACK, false, &hdr.sender, hdr.seq, findMember(id, port), &msgSize);
+            emulNet->ENsendFrame(&memberNode->addr, &hdr.other, ack, msgSize);
+            break;
             }
+            //a relayed ACK names the probed node, a direct one does not. A PING that timed out
+            //goes on as a ping request with its sequence id, so a late direct ACK still closes it
+            MessageStatus *probe = (hdr.flags & WIRE_HAS_OTHER) ? NULL : findProbe(PING, hdr.seq, NULL);
+            if (!probe)
+                probe = findProbe(PINGREQ, hdr.seq, NULL);
+            if (!probe)
+                break;
+            probe->ackReceived = true;
+            probe->isActive = false;
+            //an answer in time lowers the health multiplier
+            if (probe->type == PING)
+                adjustHealth(-1);
             break;
         }
          /* node receives ping request message, updates its membership list and sends ping reply message
          (SWIM protocol style message exchange system) */
         case PINGREQ:{
-            updateMemberList(msg,size);
-            Address SenderAddress;
-            memcpy(&SenderAddress.addr, (char *)(msg + 1), sizeof(SenderAddress.addr));
-            Address pingAddr;
-            memcpy(&pingAddr.addr,(char *)(msg + 1)+1+sizeof(SenderAddress.addr),sizeof(pingAddr.addr));
-            int countEntries=0;
-            for (auto it = memberNode->memberList.begin(); it != memberNode->memberList.end(); ++it)
+            updateMemberList(reader);
+            int id;
+            short port;
+            memcpy(&id, &hdr.other.addr[0], sizeof(int));
+            memcpy(&port, &hdr.other.addr[4], sizeof(short));
+            //the requester gets a NACK if the probed node does not answer within its PING_TIMEOUT
+            MessageStatus &relay = trackProbe(ACK, hdr.seq, memberKey(id, port), PING_TIMEOUT);
+            relay.peer = hdr.sender;
+            int msgSize;
+            char *ping = newProbe(PING, true, &hdr.sender, hdr.seq, NULL, &msgSize);
+            emulNet->ENsendFrame(&memberNode->addr, &hdr.other, ping, msgSize);
+            break;
+        }
+         /* a proxy of a ping request did not hear from the probed node, which still tells
+         this node that the proxy can be reached */
+        case NACK:{
+            updateMemberList(reader);
+            MessageStatus *probe = findProbe(PINGREQ, hdr.seq, NULL);
+            if (!probe)
+                break;
+            for (int i = 0; i < probe->pendingCount; ++i)
             {
-              if((par->getcurrtime()-it->timestamp)<=TFAIL)
-              ++countEntries;
+                if (0 == memcmp(probe->pending[i].addr, hdr.sender.addr, sizeof(hdr.sender.addr)))
+                {
+                    probe->pending[i] = probe->pending[--probe->pendingCount];
+                    break;
+                }
             }
-            size_t flagSize=countEntries*sizeof(char);
-            size_t listSize = static_cast<size_t>(countEntries) * sizeof(MemberListEntry);
-            //prepare a PING message
-            size_t msgSize=sizeof(MessageHdr)+sizeof(memberNode->addr.addr)*2+listSize+1+flagSize;
-            MessageHdr* ping =(MessageHdr*)malloc(msgSize*sizeof(char));//allocation in bytes
-            ping->msgType=PING;
-            bool fromPingreq=true;
-            memcpy((char*)(ping+1), &memberNode->addr.addr, sizeof(memberNode->addr.addr));
-            memcpy((char*)(ping+1)+sizeof(memberNode->addr.addr),&fromPingreq,sizeof(bool));
-            memcpy((char*)(ping+1)+sizeof(memberNode->addr.addr)+1,&SenderAddress.addr,sizeof(SenderAddress.addr));
-            char* ptr = (char*)(ping + 1) + sizeof(memberNode->addr.addr)*2 + sizeof(bool);
-            for (auto it = memberNode->memberList.begin(); it != memberNode->memberList.end(); ++it)
-           {
-            if ((par->getcurrtime() - it->timestamp) <= TFAIL)
-            { 
-               bool addOrupdate=true;
-               memcpy(ptr, &(*it), sizeof(MemberListEntry));
-               memcpy(ptr+sizeof(MemberListEntry),&addOrupdate,sizeof(bool));
-               ptr += sizeof(MemberListEntry)+sizeof(bool);
-            }        
-           } 
-            emulNet->ENsend(&memberNode->addr, &pingAddr, (char *)ping, msgSize);
-            free(ping);
             break;
         }
-         /* node receives gossip message, updates its membership list and spreads gossip msg 
+         /* node receives gossip message, updates its membership list and spreads gossip msg
          if necessary */
         case GOSSIP:{
-            //extract time to live value
-            int ttl;
-            memcpy(&ttl,(char *)(msg + 1),sizeof(int));
-            --ttl;
-            /* extract memberListEntries and merge into nodes own memberList.
-            since the received message structure is different than in most cases, it would take
-            extra steps in order to reuse updateMemberList() function, so this message is processed 
-            independently */
-            size_t myPosIndex = std::distance(memberNode->memberList.begin(), memberNode->myPos);
-            char* ptr = (char*)(msg + 1);
-            ptr+=sizeof(int);
-            while(ptr-(char*)msg<size)
+            int ttl = hdr.ttl - 1;
+            /* merge the entries into nodes own memberList. A GOSSIP only adds or updates,
+            removals are confirmed by each node on its own */
+            while (reader.nextEntry(&sendersEntry, &kind))
             {
-                MemberListEntry sendersEntry;
-                memcpy(&sendersEntry, ptr, sizeof(MemberListEntry));
-                ptr+=sizeof(MemberListEntry);
-                bool addOrupdate;
-                memcpy(&addOrupdate,ptr,sizeof(bool));
-                ptr += sizeof(bool);
-                if(addOrupdate)
+                if (kind == DELTA_DEAD)
+                    continue;
+                //determine if sendersEntry exists in your memberList
+                MemberListEntry *known = findMember(sendersEntry.id, sendersEntry.port);
+                if (known)
                 {
-                    bool exists = false;
-                    for (auto it = memberNode->memberList.begin(); it != memberNode->memberList.end(); ++it)
-                    {
-                        //determine if sendersEntry exists in your memberList
-                        if(it->id==sendersEntry.id&&it->port==sendersEntry.port)
-                        {
-                            exists=true;
-                            if(sendersEntry.heartbeat>it->heartbeat)
-                            {
-                                it->setheartbeat(sendersEntry.heartbeat);
-                                it->settimestamp(par->getcurrtime());
-                            }
-                            break;
-                        }
-                    }
-                    if(!exists)
-                    {
-                    //add a new element to membership list and log it
-                    Address logAddr=getAddr(sendersEntry.id,sendersEntry.port);
-                    memberNode->memberList.push_back(MemberListEntry(sendersEntry.id,sendersEntry.port,sendersEntry.heartbeat,par->getcurrtime()));
-                    #ifdef DEBUGLOG
-                    log->logNodeAdd(&memberNode->addr, &logAddr);
-                    #endif 
-                    memberNode->myPos = memberNode->memberList.begin() + myPosIndex;                   
-                    //send GOSSIP with TTL=3 to 2 random nodes
-                    int ttl=TTL;
-                    bool AddOrUpdate=true;
-                    size_t msgSize=sizeof(MessageHdr)+sizeof(int)+sizeof(MemberListEntry)+sizeof(bool);
-                    MessageHdr* gossip =(MessageHdr*)malloc(msgSize*sizeof(char));
-                    gossip->msgType=GOSSIP;
-                    MemberListEntry entry{sendersEntry.id,sendersEntry.port,sendersEntry.heartbeat,par->getcurrtime()};
-                    memcpy((char*)(gossip+1), &ttl, sizeof(int));
-                    memcpy((char*)(gossip+1)+sizeof(int), &entry, sizeof(MemberListEntry));
-                    memcpy((char*)(gossip+1)+sizeof(int)+sizeof(MemberListEntry),&AddOrUpdate,sizeof(bool));
-                    sendGossip(gossip,msgSize);
-                    free(gossip);
-                    }                   
-
+                    refreshMember(known, sendersEntry);
+                }
+                else if (!removedSince(sendersEntry))
+                {
+                //add a new element to membership list and log it
+                Address logAddr=getAddr(sendersEntry.id,sendersEntry.port);
+                MemberListEntry entry{sendersEntry.id,sendersEntry.port,sendersEntry.heartbeat,par->getcurrtime()};
+                entry.incarnation=sendersEntry.incarnation;
+                addMember(entry);
+                #ifdef DEBUGLOG
+                log->logNodeAdd(&memberNode->addr, &logAddr);
+                #endif
+                //send GOSSIP with TTL=3 to 2 random nodes
+                gossipEntry(entry);
                 }
-                else
-                {   /*
-                    //this is executed when the entry needs to be deleted from the list
-                    for (auto it = memberNode->memberList.begin(); it != memberNode->memberList.end();)
-                    { 
-                        if (it->id==sendersEntry.id&&it->port==sendersEntry.port)//find the entry
-                        {
-                        Address removeAddr=getAddr(it->id,it->port);
-                        it = memberNode->memberList.erase(it);
-                        #ifdef DEBUGLOG
-                        log->logNodeRemove(&memberNode->addr, &removeAddr);
-                        #endif
-                        //send GOSSIP with TTL=3 to 2 random nodes
-                        int ttl=TTL;
-                        bool AddOrUpdate=false;
-                        size_t msgSize=sizeof(MessageHdr)+sizeof(int)+sizeof(MemberListEntry)+sizeof(bool);
-                        MessageHdr* gossip =(MessageHdr*)malloc(msgSize*sizeof(char));
-                        gossip->msgType=GOSSIP;
-                        MemberListEntry entry{sendersEntry.id,sendersEntry.port,sendersEntry.heartbeat,par->getcurrtime()};
-                        memcpy((char*)(gossip+1), &ttl, sizeof(int));
-                        memcpy((char*)(gossip+1)+sizeof(int), &entry, sizeof(MemberListEntry));
-                        memcpy((char*)(gossip+1)+sizeof(int)+sizeof(MemberListEntry),&AddOrUpdate,sizeof(bool));
-                        sendGossip(gossip,msgSize); 
-                        free(gossip);                  
-                        }
-                        else 
-                        {
-                            ++it;
-                        }
-                    }
-                    if (myPosIndex < memberNode->memberList.size()) 
-                    { memberNode->myPos = memberNode->memberList.begin() + myPosIndex; } 
-                    else { memberNode->myPos = memberNode->memberList.end(); } */
-                }           
             }
             if(ttl>0)
             {
-                memcpy((char*)(msg+1), &ttl, sizeof(int));
-                sendGossip(msg,size);
-            }  
+                //the received frame may be shared with other receivers, forward a copy
+                char *forward = newMessage(GOSSIP, size);
+                memcpy(forward, data, size);
+                MemberReader::setTtl(forward, ttl);
+                sendGossip(forward, size);
+            }
             break;
         }
             default:
@@ -717,130 +477,574 @@ bool MP1Node::recvCallBack(void *env, char *data, int size ) {
 /**
  * FUNCTION NAME: sendPingRequest
  *
- * DESCRIPTION: implementation of SWIM style protocol message exchanging system
+ * DESCRIPTION: implementation of SWIM style protocol message exchanging system. An
+ * 				escalated ping request keeps the sequence id seq of the PING it follows.
  */
-void MP1Node::sendPingRequest(const MemberListEntry &entry)
+void MP1Node::sendPingRequest(const MemberListEntry &entry, int seq, bool escalated)
 {
     Address toAddr;
     memcpy(&toAddr.addr[0], &entry.id, sizeof(int));
 	memcpy(&toAddr.addr[4], &entry.port, sizeof(short));
-    int countEntries=0;
-    for (auto it = memberNode->memberList.begin(); it != memberNode->memberList.end(); ++it)
+    vector<Address> &proxies = randomAddresses(std::min(par->INDIRECT_PROBERS, MAX_INDIRECT_PROBERS));
+    //each proxy answers with the ACK of the probed node or a NACK, the wait covers its timeout and the way there and back
+    MessageStatus &status = trackProbe(PINGREQ, seq, memberKey(entry.id, entry.port), scaledTimeout(2 * PING_TIMEOUT));
+    status.pendingCount = (int)proxies.size();
+    std::copy(proxies.begin(), proxies.end(), status.pending);
+    status.escalated = escalated;
+    int msgSize;
+    char *ping = newProbe(PINGREQ, true, &toAddr, status.id, NULL, &msgSize);//one frame shared by all proxies
+    emulNet->ENsendMulti(&memberNode->addr, proxies, ping, msgSize);
+    return;
+}
+/**
+ * FUNCTION NAME: sendPingRequest
+ *
+ * DESCRIPTION: implementation of SWIM style protocol message exchanging system
+ */
+void MP1Node::sendPing()
+{
+    Address toAddr;
+    if (!nextProbeTarget(&toAddr))
+        return;
+    int id;
+    short port;
+    memcpy(&id, &toAddr.addr[0], sizeof(int));
+    memcpy(&port, &toAddr.addr[4], sizeof(short));
+    //unanswered within PING_TIMEOUT, it goes on as a ping request
+    MessageStatus &status = trackProbe(PING, nextProbeId++, memberKey(id, port), scaledTimeout(PING_TIMEOUT));
+    //a direct PING names no third node
+    int msgSize;
+    char *ping = newProbe(PING, false, NULL, status.id, NULL, &msgSize);
+    emulNet->ENsendFrame(&memberNode->addr, &toAddr, ping, msgSize);
+    return;
+
+}
+/**
+ * FUNCTION NAME: sendPingRequest
+ *
+ * DESCRIPTION: implementation of gossip style message exchanging system
+ */
+void MP1Node::sendGossip(char *msg, int msgSize)
+{
+    emulNet->ENsendMulti(&memberNode->addr, randomAddresses(GOSSIP_FANOUT), msg, msgSize);
+    return;
+}
+/**
+ * FUNCTION NAME: gossipEntry
+ *
+ * DESCRIPTION: GOSSIP of a single member new to this node, with a fresh TTL
+ */
+void MP1Node::gossipEntry(const MemberListEntry &entry)
+{
+    MemberWriter writer(scratch, WIRE_MAX_HEADER + WIRE_MAX_ENTRY, par->getcurrtime());
+    writer.putHeader(GOSSIP, 0, TTL, &memberNode->addr, NULL, 0);
+    writer.putEntry(entry, DELTA_ALIVE);
+    int msgSize;
+    char *gossip = finishMessage(GOSSIP, writer, &msgSize);
+    sendGossip(gossip, msgSize);
+}
+/**
+ * FUNCTION NAME: newMessage
+ *
+ * DESCRIPTION: EmulNet frame with room for size bytes of a message of type, tagged
+ * 				for the traffic accounting
+ */
+char *MP1Node::newMessage(enum MsgTypes type, size_t size)
+{
+    return emulNet->ENgetFrame(size, EN_LAYER_MP1, type);
+}
+/**
+ * FUNCTION NAME: finishMessage
+ *
+ * DESCRIPTION: Frame of a message of type holding what writer built in scratch. The
+ * 				frame is only as big as the message, whatever room writer allowed for.
+ */
+char *MP1Node::finishMessage(enum MsgTypes type, MemberWriter &writer, int *msgSize)
+{
+    *msgSize = writer.finish();
+    char *msg = newMessage(type, *msgSize);
+    memcpy(msg, scratch.data(), *msgSize);
+    return msg;
+}
+/**
+ * FUNCTION NAME: newProbe
+ *
+ * DESCRIPTION: PING, ACK, PINGREQ or NACK frame: the header with fromPingreq, the
+ * 				address of the third node of an indirect probe if other is given and
+ * 				the sequence id of the probe, then this node's own entry, about if
+ * 				given, and as many buffered deltas as fit in a single frame
+ */
+char *MP1Node::newProbe(enum MsgTypes type, bool fromPingreq, Address *other, int seq, MemberListEntry *about, int *msgSize)
+{
+    MemberWriter writer(scratch, emulNet->ENmaxPayload(), par->getcurrtime());
+    writer.putHeader(type, fromPingreq ? WIRE_FROM_PINGREQ : 0, 0, &memberNode->addr, other, seq);
+    writer.putEntry(*memberNode->myPos, DELTA_ALIVE);
+    if (about)
+        writer.putEntry(*about, DELTA_ALIVE);
+    putDeltas(writer);
+    return finishMessage(type, writer, msgSize);
+}
+/**
+ * FUNCTION NAME: fewerSends
+ *
+ * DESCRIPTION: Order of the dissemination buffer, least sent first, ties by member
+ */
+bool MP1Node::fewerSends(const MemberDelta *a, const MemberDelta *b)
+{
+    if (a->sends != b->sends)
+        return a->sends < b->sends;
+    return memberKey(a->entry.id, a->entry.port) < memberKey(b->entry.id, b->entry.port);
+}
+/**
+ * FUNCTION NAME: putDeltas
+ *
+ * DESCRIPTION: Write the least sent deltas that fit. A delta leaves the buffer
+ * 				once it was sent DELTA_LAMBDA * log(n) times, n the size of the group.
+ */
+void MP1Node::putDeltas(MemberWriter &writer)
+{
+    int limit = DELTA_LAMBDA * (int)ceil(log10((double)memberNode->memberList.size() + 1));
+    //no more than could fit if every entry took the fewest bytes
+    size_t count = std::min(queued.size(), (size_t)(writer.room() / WIRE_MIN_ENTRY));
+    std::partial_sort(queued.begin(), queued.begin() + count, queued.end(), fewerSends);
+    for (size_t i = 0; i < count && writer.putEntry(queued[i]->entry, queued[i]->kind); ++i)
+        ++queued[i]->sends;
+    size_t kept = 0;
+    for (size_t i = 0; i < queued.size(); ++i)
     {
-        if((par->getcurrtime()-it->timestamp)<=TFAIL)
-        ++countEntries;
+        if (queued[i]->sends >= limit)
+        {
+            queued[i]->queued = false;
+            continue;
+        }
+        queued[kept++] = queued[i];
     }
-    size_t flagSize=countEntries*sizeof(char);
-    size_t listSize = static_cast<size_t>(countEntries) * sizeof(MemberListEntry);
-    //prepare a PING message
-    size_t msgSize=sizeof(MessageHdr)+sizeof(memberNode->addr.addr)*2+listSize+1+flagSize;
-    MessageHdr* ping =(MessageHdr*)malloc(msgSize*sizeof(char));//allocation in bytes
-    ping->msgType=PINGREQ;
-    bool fromPingreq=true;
-    memcpy((char*)(ping+1), &memberNode->addr.addr, sizeof(memberNode->addr.addr));
-    memcpy((char*)(ping+1)+sizeof(memberNode->addr.addr),&fromPingreq,sizeof(bool));
-    memcpy((char*)(ping+1)+sizeof(memberNode->addr.addr)+1,&toAddr.addr,sizeof(toAddr.addr));
-    char* ptr = (char*)(ping + 1) + sizeof(memberNode->addr.addr)*2 + sizeof(bool);
-    for (auto it = memberNode->memberList.begin(); it != memberNode->memberList.end(); ++it)
+    queued.resize(kept);
+}
+/**
+ * FUNCTION NAME: queueDelta
+ *
+ * DESCRIPTION: Put news of entry in the dissemination buffer. It replaces any older
+ * 				news of the same member and is sent as often again.
+ */
+void MP1Node::queueDelta(const MemberListEntry &entry, char kind)
+{
+    //the first news of a member adds its delta, later news reuses it
+    MemberDelta &delta = deltas[memberKey(entry.id, entry.port)];
+    delta.entry = entry;
+    delta.kind = kind;
+    delta.sends = 0;
+    if (!delta.queued)
     {
-        if ((par->getcurrtime() - it->timestamp) <= TFAIL)
-        { 
-           bool addOrupdate=true;
-           memcpy(ptr, &(*it), sizeof(MemberListEntry));
-           memcpy(ptr+sizeof(MemberListEntry),&addOrupdate,sizeof(bool));
-           ptr += sizeof(MemberListEntry)+sizeof(bool);
-        }        
+        delta.queued = true;
+        queued.push_back(&delta);
     }
-    int excludeid;
-    Address pingAddr;
-    for(int i=0; i<2;++i)
+}
+/**
+ * FUNCTION NAME: applyDelta
+ *
+ * DESCRIPTION: Merge an entry received with a delta kind into the membership list.
+ * 				What is news here is queued to be passed on. A suspicion of a member
+ * 				known here with newer news is answered with that news, otherwise the
+ * 				member is suspected here too. A suspicion of this node is refuted with
+ * 				a higher incarnation.
+ */
+void MP1Node::applyDelta(const MemberListEntry &entry, char kind)
+{
+    MemberListEntry *known = findMember(entry.id, entry.port);
+    if (known == &*memberNode->myPos)
     {
-        if(i==0)
+        if ((kind == DELTA_SUSPECT || kind == DELTA_DEAD) && entry.incarnation >= known->incarnation)
         {
-            pingAddr=getRandomAddress();
-            emulNet->ENsend(&memberNode->addr, &pingAddr, (char *)ping, msgSize);
-            memcpy(&excludeid, &pingAddr.addr[0],sizeof(int));
+            known->incarnation = entry.incarnation + 1;
+            queueDelta(*known, DELTA_ALIVE);
         }
-        else
+        return;
+    }
+    switch (kind)
+    {
+        case DELTA_JOIN:
+        case DELTA_ALIVE: {
+            if (known)
+            {
+                if (refreshMember(known, entry))
+                    queueDelta(*known, DELTA_ALIVE);
+                break;
+            }
+            if (removedSince(entry))
+                break;
+            MemberListEntry added(entry.id,entry.port,entry.heartbeat,par->getcurrtime());
+            added.incarnation = entry.incarnation;
+            addMember(added);
+            #ifdef DEBUGLOG
+            Address addAddr=getAddr(entry.id,entry.port);
+            log->logNodeAdd(&memberNode->addr, &addAddr);
+            #endif
+            queueDelta(added, DELTA_JOIN);
+            break;
+        }
+        case DELTA_SUSPECT:
+        case DELTA_DEAD: {
+            //confirming stays this node's own TREMOVE decision, a confirmation elsewhere is only a suspicion here
+            if (!known)
+                break;
+            if (newerThan(*known, entry))
+            {
+                queueDelta(*known, DELTA_ALIVE);
+                break;
+            }
+            if (known->state == MEMBER_ALIVE)
+            {
+                known->state = MEMBER_SUSPECT;
+                queueDelta(*known, DELTA_SUSPECT);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+/**
+ * FUNCTION NAME: newerThan
+ *
+ * DESCRIPTION: Whether a is newer news of a member than b, by incarnation then heartbeat
+ */
+bool MP1Node::newerThan(const MemberListEntry &a, const MemberListEntry &b)
+{
+    if (a.incarnation != b.incarnation)
+        return a.incarnation > b.incarnation;
+    return a.heartbeat > b.heartbeat;
+}
+/**
+ * FUNCTION NAME: refreshMember
+ *
+ * DESCRIPTION: Take news of a known member if it is newer. The member is heard of,
+ * 				so a suspicion of it is cleared.
+ *
+ * RETURNS:
+ * true if known was updated
+ */
+bool MP1Node::refreshMember(MemberListEntry *known, const MemberListEntry &news)
+{
+    if (!newerThan(news, *known))
+        return false;
+    if (!suspicions.empty())
+        suspicions.erase(memberKey(known->id, known->port));
+    known->setheartbeat(news.heartbeat);
+    known->settimestamp(par->getcurrtime());
+    known->incarnation = news.incarnation;
+    known->state = MEMBER_ALIVE;
+    return true;
+}
+/**
+ * FUNCTION NAME: removedSince
+ *
+ * DESCRIPTION: Whether entry is older news than the removal of its member. Newer news
+ * 				brings the member back, so the removal is forgotten.
+ */
+bool MP1Node::removedSince(const MemberListEntry &entry)
+{
+    auto removed = removedMembers.find(memberKey(entry.id, entry.port));
+    if (removed == removedMembers.end())
+        return false;
+    if (!newerThan(entry, removed->second))
+        return true;
+    removedMembers.erase(removed);
+    return false;
+}
+/**
+ * FUNCTION NAME: noteRemoval
+ *
+ * DESCRIPTION: Confirm the failure of a member about to be removed, remember its entry
+ * 				and queue the news
+ */
+void MP1Node::noteRemoval(const MemberListEntry &entry)
+{
+    MemberListEntry confirmed(entry);
+    confirmed.state = MEMBER_CONFIRMED;
+    removedMembers[memberKey(entry.id, entry.port)] = confirmed;
+    suspicions.erase(memberKey(entry.id, entry.port));
+    queueDelta(confirmed, DELTA_DEAD);
+}
+/**
+ * FUNCTION NAME: memberKey
+ *
+ * DESCRIPTION: Key of the member id:port in memberIndex, the 6 address bytes packed
+ */
+unsigned long long MP1Node::memberKey(int id, short port)
+{
+    return ((unsigned long long)(unsigned int)id << 16) | (unsigned short)port;
+}
+/**
+ * FUNCTION NAME: findMember
+ *
+ * DESCRIPTION: Entry of id:port in the membership list, NULL if it is not there.
+ * 				Valid until the list is next changed.
+ */
+MemberListEntry *MP1Node::findMember(int id, short port)
+{
+    auto found = memberNode->memberIndex.find(memberKey(id, port));
+    if (found == memberNode->memberIndex.end())
+        return NULL;
+    return &memberNode->memberList[found->second];
+}
+/**
+ * FUNCTION NAME: addMember
+ *
+ * DESCRIPTION: Append entry to the membership list and index it. myPos is moved
+ * 				over to the reallocated list.
+ */
+void MP1Node::addMember(const MemberListEntry &entry)
+{
+    size_t myPosIndex = std::distance(memberNode->memberList.begin(), memberNode->myPos);
+    memberNode->memberIndex[memberKey(entry.id, entry.port)] = memberNode->memberList.size();
+    memberNode->memberList.push_back(entry);
+    memberNode->myPos = memberNode->memberList.begin() + myPosIndex;
+    //a new member is probed at a random point of the current round or the next
+    size_t pos = rng.nextInt((int)probeList.size() + 1);
+    probeList.insert(probeList.begin() + pos, memberKey(entry.id, entry.port));
+    if (pos < probeNext)
+        ++probeNext;
+}
+/**
+ * FUNCTION NAME: indexMembers
+ *
+ * DESCRIPTION: Rebuild memberIndex once entries were erased from the membership list
+ */
+void MP1Node::indexMembers()
+{
+    memberNode->memberIndex.clear();
+    for (size_t i = 0; i < memberNode->memberList.size(); ++i)
+    {
+        memberNode->memberIndex[memberKey(memberNode->memberList[i].id, memberNode->memberList[i].port)] = i;
+    }
+}
+/**
+ * FUNCTION NAME: randomAddresses
+ *
+ * DESCRIPTION: count different random members other than this node, the targets of a
+ * 				gossip or ping request. Fewer while the membership list is that short.
+ * 				Kept in a member so the fan-out does not allocate on every send.
+ */
+vector<Address> &MP1Node::randomAddresses(size_t count)
+{
+    fanout.clear();
+    fanoutIndex.clear();
+    size_t others = memberNode->memberList.size() - 1;
+    size_t self = std::distance(memberNode->memberList.begin(), memberNode->myPos);
+    count = std::min(count, others);
+    //Floyd's sampling of count indexes out of the others, one draw each
+    for (size_t j = others - count; j < others; ++j)
+    {
+        size_t pick = rng.nextInt((int)j + 1);
+        if (std::find(fanoutIndex.begin(), fanoutIndex.end(), pick) != fanoutIndex.end())
+            pick = j;
+        fanoutIndex.push_back(pick);
+    }
+    for (auto it = fanoutIndex.begin(); it != fanoutIndex.end(); ++it)
+    {
+        //skip over this node's own index
+        MemberListEntry &entry = memberNode->memberList[*it >= self ? *it + 1 : *it];
+        fanout.push_back(getAddr(entry.id, entry.port));
+    }
+    return fanout;
+}
+/**
+ * FUNCTION NAME: nextProbeTarget
+ *
+ * DESCRIPTION: Next member of the probe list. A round probes every member once in a
+ * 				shuffled order, then the list is rebuilt from memberList and shuffled
+ * 				again, so a member is probed within two rounds whatever the draw.
+ *
+ * RETURNS:
+ * false if there is no other member to probe
+ */
+bool MP1Node::nextProbeTarget(Address *target)
+{
+    for (int rounds = 0; rounds < 2; ++rounds)
+    {
+        while (probeNext < probeList.size())
         {
-            pingAddr=getRandomAddress(excludeid);
-            emulNet->ENsend(&memberNode->addr, &pingAddr, (char *)ping, msgSize);
+            auto found = memberNode->memberIndex.find(probeList[probeNext++]);
+            if (found != memberNode->memberIndex.end())
+            {
+                MemberListEntry &entry = memberNode->memberList[found->second];
+                *target = getAddr(entry.id, entry.port);
+                return true;
+            }
         }
+        shuffleProbeList();
     }
-    free(ping);
-    return;
+    return false;
 }
 /**
- * FUNCTION NAME: sendPingRequest
+ * FUNCTION NAME: shuffleProbeList
  *
- * DESCRIPTION: implementation of SWIM style protocol message exchanging system
+ * DESCRIPTION: Start a probe round over every member but this node, in random order
  */
-void MP1Node::sendPing()
+void MP1Node::shuffleProbeList()
 {
-    Address toAddr=getRandomAddress(); 
-    //collect recent updates from memberList and piggyback them on PING message
-    //calculate the number of entries to include in the message
-    int countEntries=0;
+    probeList.clear();
     for (auto it = memberNode->memberList.begin(); it != memberNode->memberList.end(); ++it)
     {
-        if((par->getcurrtime()-it->timestamp)<=TFAIL)
-        ++countEntries;
+        if (it != memberNode->myPos)
+            probeList.push_back(memberKey(it->id, it->port));
     }
-    size_t flagSize=countEntries*sizeof(char);
-    size_t listSize = static_cast<size_t>(countEntries) * sizeof(MemberListEntry);
-    //prepare a PING message
-    //the *2 in sizeof(memberNode->addr.addr)*2 is used as a placeholder for this message to
-    //be compatible with msgUpdate
-    Address dummyAddr;
-    dummyAddr.init();    
-    size_t msgSize=sizeof(MessageHdr)+sizeof(memberNode->addr.addr)*2+listSize+1+flagSize;
-    MessageHdr* ping =(MessageHdr*)malloc(msgSize*sizeof(char));//allocation in bytes
-    ping->msgType=PING;
-    bool fromPingreq=false;
-    memcpy((char*)(ping+1), &memberNode->addr.addr, sizeof(memberNode->addr.addr));
-    memcpy((char*)(ping+1)+sizeof(memberNode->addr.addr),&fromPingreq,sizeof(bool));
-    memcpy((char*)(ping+1)+sizeof(memberNode->addr.addr)+1,&dummyAddr.addr,sizeof(dummyAddr.addr));
-    char* ptr = (char*)(ping + 1) + sizeof(memberNode->addr.addr)*2 + sizeof(bool);
-    for (auto it = memberNode->memberList.begin(); it != memberNode->memberList.end(); ++it)
+    for (size_t i = probeList.size(); i > 1; --i)
     {
-        if ((par->getcurrtime() - it->timestamp) <= TFAIL)
-        { 
-           bool addOrupdate=true;
-           memcpy(ptr, &(*it), sizeof(MemberListEntry));
-           memcpy(ptr+sizeof(MemberListEntry),&addOrupdate,sizeof(bool));
-           ptr += sizeof(MemberListEntry)+sizeof(bool);
-        }        
+        std::swap(probeList[i - 1], probeList[rng.nextInt((int)i)]);
     }
-    emulNet->ENsend(&memberNode->addr, &toAddr, (char *)ping, msgSize);
-    free(ping);
-    return;
-
+    probeNext = 0;
 }
 /**
- * FUNCTION NAME: sendPingRequest
+ * FUNCTION NAME: dropProbe
  *
- * DESCRIPTION: implementation of gossip style message exchanging system
+ * DESCRIPTION: Take a removed member out of the probe list
+ */
+void MP1Node::dropProbe(unsigned long long key)
+{
+    auto found = std::find(probeList.begin(), probeList.end(), key);
+    if (found == probeList.end())
+        return;
+    if ((size_t)(found - probeList.begin()) < probeNext)
+        --probeNext;
+    probeList.erase(found);
+}
+/**
+ * FUNCTION NAME: adjustHealth
+ *
+ * DESCRIPTION: Move the local health multiplier by delta, within 0 and MAX_HEALTH.
+ * 				Missed ACKs with missed NACKs and a backlog in mp1q raise it, ACKs in
+ * 				time lower it. Refuting a suspicion does not count, members not heard
+ * 				of for TFAIL are suspected all the time here.
+ */
+void MP1Node::adjustHealth(int delta)
+{
+    health = std::max(0, std::min(MAX_HEALTH, health + delta));
+}
+/**
+ * FUNCTION NAME: scaledTimeout
+ *
+ * DESCRIPTION: timeout stretched by the local health multiplier
+ */
+int MP1Node::scaledTimeout(int timeout)
+{
+    return timeout * (health + 1);
+}
+/**
+ * FUNCTION NAME: trackProbe
+ *
+ * DESCRIPTION: Record a probe of target sent with sequence id, expiring timeout
+ * 				ticks from now
+ */
+MessageStatus &MP1Node::trackProbe(enum MsgTypes type, int id, unsigned long long target, int timeout)
+{
+    MessageStatus status;
+    status.id = id;
+    status.timeout = par->getcurrtime() + timeout;
+    status.ackReceived = false;
+    status.isActive = true;
+    status.type = type;
+    status.target = target;
+    status.peer.init();
+    status.pendingCount = 0;
+    status.escalated = false;
+    probes.push_back(status);
+    return probes.back();
+}
+/**
+ * FUNCTION NAME: findProbe
+ *
+ * DESCRIPTION: Active probe of type with sequence id, NULL if there is none. A relay
+ * 				also has to be for the requester peer, the ids of requesters overlap.
  */
-void MP1Node::sendGossip(MessageHdr*msg, size_t msgSize)
+MessageStatus *MP1Node::findProbe(enum MsgTypes type, int id, Address *peer)
 {
-    int excludeid;
-    Address gossipAddr;
-    for(int i=0; i<2;++i)
+    for (auto it = probes.begin(); it != probes.end(); ++it)
     {
-        if(i==0)
+        if (it->isActive && it->type == type && it->id == id && (!peer || 0 == memcmp(it->peer.addr, peer->addr, sizeof(peer->addr))))
+            return &*it;
+    }
+    return NULL;
+}
+/**
+ * FUNCTION NAME: expireProbes
+ *
+ * DESCRIPTION: Drop the probes that were answered and act on those that timed out.
+ * 				A PING goes on as a ping request, a relay is answered with a NACK and
+ * 				a ping request has failed.
+ */
+void MP1Node::expireProbes()
+{
+    int now = par->getcurrtime();
+    size_t kept = 0;
+    //ping requests sent from here are appended behind count and kept as they are
+    size_t count = probes.size();
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (probes[i].isActive && probes[i].timeout <= now)
         {
-            gossipAddr=getRandomAddress();
-            memcpy(&excludeid, &gossipAddr.addr[0],sizeof(int));
-            emulNet->ENsend(&memberNode->addr, &gossipAddr, (char *)msg, msgSize);
-            
+            probes[i].isActive = false;
+            if (probes[i].type == PING)
+            {
+                MemberListEntry *entry = findMember((int)(probes[i].target >> 16), (short)(probes[i].target & 0xffff));
+                if (entry)
+                    sendPingRequest(*entry, probes[i].id, true);
+            }
+            else if (probes[i].type == ACK)
+            {
+                Address target = getAddr((int)(probes[i].target >> 16), (short)(probes[i].target & 0xffff));
+                int msgSize;
+                char *nack = newProbe(NACK, false, &target, probes[i].id, NULL, &msgSize);
+                emulNet->ENsendFrame(&memberNode->addr, &probes[i].peer, nack, msgSize);
+            }
+            else
+            {
+                probeFailed(probes[i]);
+            }
         }
-        else
+        if (probes[i].isActive)
         {
-            gossipAddr=getRandomAddress(excludeid);
-            emulNet->ENsend(&memberNode->addr, &gossipAddr, (char *)msg, msgSize);
+            if (kept != i)
+                probes[kept] = std::move(probes[i]);
+            ++kept;
         }
     }
-    return;
+    probes.erase(probes.begin() + kept, probes.begin() + count);
+}
+/**
+ * FUNCTION NAME: probedOut
+ *
+ * DESCRIPTION: Whether the member of key failed a probe and did not refute the
+ * 				suspicion within SUSPICION_TIMEOUT
+ */
+bool MP1Node::probedOut(unsigned long long key)
+{
+    auto suspected = suspicions.find(key);
+    return suspected != suspicions.end() && par->getcurrtime() - suspected->second > scaledTimeout(SUSPICION_TIMEOUT);
+}
+/**
+ * FUNCTION NAME: probeFailed
+ *
+ * DESCRIPTION: No proxy of a ping request heard from the probed member. It is suspected
+ * 				and has SUSPICION_TIMEOUT to refute it before it is removed. When the ping
+ * 				request followed a missed PING, any proxy that did not even NACK it raises
+ * 				the health multiplier, whatever this node thinks of the proxy: on a lossy
+ * 				network the proxies are as likely to be suspected as the probed member.
+ * 				Once per probe period at most, as only an escalated ping request counts.
+ */
+void MP1Node::probeFailed(MessageStatus &status)
+{
+    if (status.escalated && status.pendingCount > 0)
+        adjustHealth(1);
+    MemberListEntry *entry = findMember((int)(status.target >> 16), (short)(status.target & 0xffff));
+    if (!entry || entry == &*memberNode->myPos)
+        return;
+    entry->state = MEMBER_SUSPECT;
+    if (suspicions.find(status.target) == suspicions.end())
+        suspicions[status.target] = par->getcurrtime();
+    //let the group know, the suspected node refutes it once the news reaches it
+    queueDelta(*entry, DELTA_SUSPECT);
 }
 /**
  * FUNCTION NAME: nodeLoopOps
@@ -856,20 +1060,34 @@ void MP1Node::nodeLoopOps() {
     memberNode->myPos->heartbeat=memberNode->heartbeat;
     memberNode->myPos->timestamp=par->getcurrtime();
     size_t myPosIndex = std::distance(memberNode->memberList.begin(), memberNode->myPos);
+    size_t listSize = memberNode->memberList.size();
+    //a node in poor health waits longer before it suspects or removes others
+    int probeTimeout = scaledTimeout(TFAIL);
+    int suspicionTimeout = scaledTimeout(TREMOVE);
+    expireProbes();
     for (auto it = memberNode->memberList.begin(); it != memberNode->memberList.end();)
     { 
         int interval=par->getcurrtime() - it->timestamp;
+        //not heard of for TFAIL, suspected until it is heard of again
+        if (it != memberNode->myPos&&interval>=probeTimeout&&it->state==MEMBER_ALIVE)
+        {
+            it->state=MEMBER_SUSPECT;
+        }
         //probes every TFAIL time units starting from TFAIL time and not including TREMOVE
-        if (it != memberNode->myPos&&interval>=TFAIL&&interval<TREMOVE&&interval%TFAIL==0)
+        if (it != memberNode->myPos&&interval>=probeTimeout&&interval<suspicionTimeout&&interval%probeTimeout==0)
         { 
-            sendPingRequest(*it);
+            sendPingRequest(*it, nextProbeId++, false);
             ++it;
             continue;        
         }
-        if (it!=memberNode->myPos&&(par->getcurrtime() - it->timestamp) > TREMOVE)
+        //a suspicion is confirmed once it was not refuted within TREMOVE of the member
+        //being last heard of, or within SUSPICION_TIMEOUT of a probe of it failing
+        if (it!=memberNode->myPos&&it->state==MEMBER_SUSPECT&&(interval > suspicionTimeout||probedOut(memberKey(it->id,it->port))))
         {
-            cout<<"logging memberNode removal from the list..."<<endl;
+            log->print("logging memberNode removal from the list...");
             Address removeAddr=getAddr(it->id,it->port);
+            noteRemoval(*it);
+            dropProbe(memberKey(it->id,it->port));
             it = memberNode->memberList.erase(it);
             #ifdef DEBUGLOG
             log->logNodeRemove(&memberNode->addr, &removeAddr);
@@ -886,6 +1104,11 @@ void MP1Node::nodeLoopOps() {
     if (myPosIndex < memberNode->memberList.size()) 
     { memberNode->myPos = memberNode->memberList.begin() + myPosIndex; } 
     else { memberNode->myPos = memberNode->memberList.end(); } 
+    //the entries behind an erased one moved down
+    if (memberNode->memberList.size() != listSize)
+    {
+        indexMembers();
+    }
     //send PING every TFAIL timeunits
     if (memberNode->pingCounter>0)
     {
@@ -894,7 +1117,7 @@ void MP1Node::nodeLoopOps() {
     if(memberNode->pingCounter==0)
     {
         sendPing();
-        memberNode->pingCounter=TFAIL;
+        memberNode->pingCounter=probeTimeout;
     }
     
     
@@ -931,43 +1154,6 @@ Address MP1Node::getAddr(int id,short port)
     *(short *)(&addr.addr[4]) = port;
     return addr;
 }
-Address MP1Node::getRandomAddress() {
-    int myId;
-    int toId;
-    memcpy(&myId, &memberNode->addr.addr[0], sizeof(int));   
-    //check that the randomly selected id is not your id
-    bool myAddr=true;
-    while(myAddr)
-    {
-      toId = rand()%(par->EN_GPSZ+1-1)+1;
-      if (myId!=toId)
-      myAddr=false;
-    }
-    Address randAddr;
-    memset(&randAddr, 0, sizeof(Address));
-    *(int *)(&randAddr.addr) = toId;
-    *(short *)(&randAddr.addr[4]) = 0;
-    return randAddr;    
-}
-Address MP1Node::getRandomAddress(int excl) {
-    int myId;
-    int toId;
-    memcpy(&myId, &memberNode->addr.addr[0], sizeof(int));   
-    //check that the randomly selected id is not your id
-    bool myAddr=true;
-    while(myAddr)
-    {
-      toId = rand()%(par->EN_GPSZ+1-1)+1;
-      if (myId!=toId&&excl!=toId)
-      myAddr=false;
-    }
-    Address randAddr;
-    memset(&randAddr, 0, sizeof(Address));
-    *(int *)(&randAddr.addr) = toId;
-    *(short *)(&randAddr.addr[4]) = 0;
-    return randAddr;    
-}
-
 /**
  * FUNCTION NAME: initMemberListTable
  *
@@ -978,6 +1164,7 @@ void MP1Node::initMemberListTable(Member *memberNode, int id, int port) {
     long currtime=par->getcurrtime();
     MemberListEntry entry{id,static_cast<short>(port),0,currtime};
     memberNode->memberList.push_back(entry);
+    memberNode->memberIndex[memberKey(id,static_cast<short>(port))] = memberNode->memberList.size() - 1;
     Address addr;
     memset(&addr, 0, sizeof(Address));
     *(int *)(&addr.addr) = id;
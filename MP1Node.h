@@ -14,6 +14,7 @@
 #include "Member.h"
 #include "EmulNet.h"
 #include "Queue.h"
+#include "MemberCodec.h"
 #include <iterator>
 
 
@@ -24,6 +25,18 @@
 #define TFAIL 5
 #define MAX_PARTIAL_LIST_SIZE 10
 #define TTL 3
+// a delta is piggybacked DELTA_LAMBDA * log(n) times
+#define DELTA_LAMBDA 4
+// highest local health multiplier, timeouts stretch up to MAX_HEALTH + 1 times
+#define MAX_HEALTH 8
+// ticks a PING waits for its ACK before ping requests go out
+#define PING_TIMEOUT 2
+// ticks a member suspected after a failed probe has to refute it
+#define SUSPICION_TIMEOUT 12
+// members a new member is gossiped to
+#define GOSSIP_FANOUT 2
+// most proxies of a ping request, whatever INDIRECT_PROBERS asks for
+#define MAX_INDIRECT_PROBERS 8
 
 /*
  * Note: You can change/add any functions in MP1Node.{h,cpp}
@@ -39,13 +52,26 @@ enum MsgTypes{
 	PING,
 	PINGREQ,
 	GOSSIP,
+	NACK,
     DUMMYLASTMSGTYPE
 };
 
+/**
+ * Kinds of membership delta, in the flags of each entry a message carries. Entries
+ * of a JOINREP or GOSSIP are all DELTA_ALIVE.
+ */
+enum DeltaKinds{
+	DELTA_DEAD,
+	DELTA_ALIVE,
+	DELTA_JOIN,
+	DELTA_SUSPECT
+};
+
 /**
  * STRUCT NAME: MessageStatus
  *
- * DESCRIPTION: Timeout and ack receive status of a message
+ * DESCRIPTION: Timeout and ack receive status of a probe in flight. id is the
+ * 				sequence id its replies carry back, timeout the tick it expires at.
  */
 typedef struct MessageStatus
 {
@@ -53,16 +79,31 @@ typedef struct MessageStatus
 	int timeout;
 	bool ackReceived;
 	bool isActive;
+	// PING or PINGREQ of this node, ACK for a ping request relayed for peer
+	enum MsgTypes type;
+	// the probed member
+	unsigned long long target;
+	Address peer;
+	// proxies of a PINGREQ that did not answer yet, with an ACK or a NACK
+	Address pending[MAX_INDIRECT_PROBERS];
+	int pendingCount;
+	// the PINGREQ follows a PING that went unanswered
+	bool escalated;
 }MessageStatus;
 
 /**
- * STRUCT NAME: MessageHdr
+ * STRUCT NAME: MemberDelta
  *
- * DESCRIPTION: Header and content of a message
+ * DESCRIPTION: News of a member waiting in the dissemination buffer
  */
-typedef struct MessageHdr {
-	enum MsgTypes msgType;
-}MessageHdr;
+typedef struct MemberDelta {
+	MemberListEntry entry;
+	char kind;
+	// times it was piggybacked so far
+	int sends;
+	// still to be piggybacked, the delta is in the queue
+	bool queued;
+}MemberDelta;
 
 /**
  * CLASS NAME: MP1Node
@@ -76,6 +117,34 @@ private:
 	Params *par;
 	Member *memberNode;
 	char NULLADDR[6];
+	// this node's own generator, for gossip and probe targets
+	Random rng;
+	// targets of the last gossip or ping request fan-out
+	vector<Address> fanout;
+	// latest news of each member. Deltas stay once sent out, so news of a member
+	// heard of before takes no allocation.
+	unordered_map<unsigned long long, MemberDelta> deltas;
+	// dissemination buffer, the deltas still to be sent, ordered for the next probe
+	vector<MemberDelta *> queued;
+	// every message is built here, then copied into a frame of just its size
+	vector<char> scratch;
+	static bool fewerSends(const MemberDelta *a, const MemberDelta *b);
+	// entry of each removed member when its failure was confirmed
+	unordered_map<unsigned long long, MemberListEntry> removedMembers;
+	// shuffled round-robin list of the members to probe, probeNext is the next one
+	vector<unsigned long long> probeList;
+	size_t probeNext;
+	// local health multiplier, Lifeguard style, 0 when healthy up to MAX_HEALTH
+	int health;
+	// mp1q still held messages of an earlier tick when new ones came in
+	bool backlogged;
+	// probes in flight, and the sequence id of the next one
+	vector<MessageStatus> probes;
+	int nextProbeId;
+	// tick each member was suspected at after a probe of it failed
+	unordered_map<unsigned long long, long> suspicions;
+	// picked indexes of the last fan-out
+	vector<size_t> fanoutIndex;
 public:
 	MP1Node(Member *, Params *, EmulNet *, Log *, Address *);
 	Member * getMemberNode() {
@@ -88,21 +157,45 @@ public:
 	int initThisNode(Address *joinaddr);
 	int introduceSelfToGroup(Address *joinAddress);
 	int finishUpThisNode();
-	bool ackreceived=false;
 	void nodeLoop();
 	void checkMessages();
-	void updateMemberList(MessageHdr*msg);
-	void updateMemberList(MessageHdr*msg,int size);
+	void updateMemberList(const MemberListEntry &news);
+	void updateMemberList(MemberReader &reader);
+	static unsigned long long memberKey(int id, short port);
+	MemberListEntry *findMember(int id, short port);
+	void addMember(const MemberListEntry &entry);
+	void indexMembers();
+	static bool newerThan(const MemberListEntry &a, const MemberListEntry &b);
+	bool refreshMember(MemberListEntry *known, const MemberListEntry &news);
+	void queueDelta(const MemberListEntry &entry, char kind);
+	void applyDelta(const MemberListEntry &entry, char kind);
+	bool removedSince(const MemberListEntry &entry);
+	void noteRemoval(const MemberListEntry &entry);
+	char *newProbe(enum MsgTypes type, bool fromPingreq, Address *other, int seq, MemberListEntry *about, int *msgSize);
+	void putDeltas(MemberWriter &writer);
 	bool recvCallBack(void *env, char *data, int size);
 	void sendPing();
-	void sendPingRequest(const MemberListEntry &entry);
-	void sendGossip(MessageHdr*msg,size_t msgSize);
+	void sendPingRequest(const MemberListEntry &entry, int seq, bool escalated);
+	// msg is an EmulNet frame, handed over to the network
+	void sendGossip(char *msg, int msgSize);
+	void gossipEntry(const MemberListEntry &entry);
+	vector<Address> &randomAddresses(size_t count);
+	bool nextProbeTarget(Address *target);
+	void shuffleProbeList();
+	void dropProbe(unsigned long long key);
+	void adjustHealth(int delta);
+	int scaledTimeout(int timeout);
+	MessageStatus &trackProbe(enum MsgTypes type, int id, unsigned long long target, int timeout);
+	MessageStatus *findProbe(enum MsgTypes type, int id, Address *peer);
+	void expireProbes();
+	void probeFailed(MessageStatus &status);
+	bool probedOut(unsigned long long key);
+	char *newMessage(enum MsgTypes type, size_t size);
+	char *finishMessage(enum MsgTypes type, MemberWriter &writer, int *msgSize);
 	void nodeLoopOps();
 	int isNullAddress(Address *addr);
 	Address getJoinAddress();
 	Address getAddr(int id,short port);
-	Address getRandomAddress();
-	Address getRandomAddress(int excl);
 	void initMemberListTable(Member *memberNode, int id, int port);
 	void printAddress(Address *addr);
 	virtual ~MP1Node();
@@ -15,6 +15,12 @@ MP2Node::MP2Node(Member *memberNode, Params *par, EmulNet * emulNet, Log * log,
 	this->log = log;
 	ht = new HashTable();
 	this->memberNode->addr = *address;
+	stabilizationTransID = 0;
+
+	static const char *messageTypeNames[] = {"CREATE", "READ", "UPDATE", "DELETE", "REPLY", "READREPLY"};
+	for ( int i = CREATE; i <= READREPLY; i++ ) {
+		emulNet->ENnameType(EN_LAYER_MP2, i, messageTypeNames[i]);
+	}
 }
 
 /**
@@ -53,13 +59,13 @@ void MP2Node::updateRing() {
 	curMemList = getMembershipList();
 	// Sort the list based on the hashCode
 	std::sort(curMemList.begin(), curMemList.end());
-	cout<<"Time: "<<par->getcurrtime()<<endl;
+	log->print("Time: %d", par->getcurrtime());
 	// Debug: Log previous ring
-    cout << "Previous ring: ";
+    string hashes;
     for (auto& node : ring) {
-        cout << node.getHashCode() << " ";
+        hashes += to_string(node.getHashCode()) + " ";
     }
-    cout << endl;
+    log->print("Previous ring: %s", hashes.c_str());
 	//check if previous memberList is equal to the current one
 	if (areNodeVectorsEqual(curMemList, ring))
 	{
@@ -68,11 +74,11 @@ void MP2Node::updateRing() {
 	//create the ring 
 	ring = curMemList;
 	 // Debug: Log new ring
-    cout << "     New ring: ";
+    hashes.clear();
     for (auto& node : ring) {
-        cout << node.getHashCode() << " ";
+        hashes += to_string(node.getHashCode()) + " ";
     }
-    cout << endl;
+    log->print("     New ring: %s", hashes.c_str());
 	// Run stabilization protocol if the hash table size is greater than zero and if there has been a changed in the ring
 	if (change && !ht->isEmpty())
 	{
@@ -137,46 +143,53 @@ void MP2Node::findNeighbors()
 	{ 
 		return compareNodeWithMember(node, *memberNode); 
 	});
+	if (ring.empty()) 
+	{ 
+		return; 
+	}
+	// Walk the ring by index so both directions wrap around
+	int size = ring.size();
+	int myIndex = std::distance(ring.begin(), myPosition);
 	// Find the next two nodes for hasMyReplicas
 	for (int i = 1; i <= 2; ++i) 
 	{ 
-		auto nextNode = myPosition; 
-		std::advance(nextNode, i); 
-		if (nextNode == ring.end()) 
-		{ 
-			nextNode = ring.begin(); 
-		} 
-		hasMyReplicas.push_back(*nextNode); 
+		hasMyReplicas.push_back(ring[(myIndex + i) % size]); 
 	}
 	// Find the previous two nodes for haveReplicasOf 
 	for (int i = 1; i <= 2; ++i) 
 	{ 
-		auto prevNode = myPosition; 
-		std::advance(prevNode, -i); 
-		if (prevNode < ring.begin()) 
-		{ 
-			prevNode = ring.end() - (ring.begin() - prevNode); 
-		} 
-		haveReplicasOf.push_back(*prevNode); 
+		haveReplicasOf.push_back(ring[((myIndex - i) % size + size) % size]); 
 	}
 }
 /**
  * FUNCTION NAME: dispatchMessages
  *
- * DESCRIPTION: function for dispatching messages to the destination nodes
+ * DESCRIPTION: function for dispatching messages to the destination nodes.
+ * 				The message is serialized once and all replicas share the frame.
  */
 void MP2Node::dispatchMessages(Message message)
 {
 	vector<Node> replicas = findNodes(message.key); 
-	// Dispatch the message to the target nodes 
-	for (Node node : replicas) 
+	vector<Address> toList;
+	toList.reserve(replicas.size());
+	for (Node &node : replicas) 
 	{ 
-		// Serialize the message to a string 
-		string serializedMessage = message.toString(); 
-		// Send message to the replica node 		
-		emulNet->ENsend(&memberNode->addr, &node.nodeAddress, serializedMessage);
+		toList.push_back(node.nodeAddress);
 	}
-
+	char *frame = emulNet->ENgetFrame(message.maxSize(), EN_LAYER_MP2, message.type);
+	int size = message.serialize(frame);
+	emulNet->ENsendMulti(&memberNode->addr, toList, frame, size);
+}
+/**
+ * FUNCTION NAME: sendMessage
+ *
+ * DESCRIPTION: Serialize the message straight into an EmulNet frame and send it
+ */
+void MP2Node::sendMessage(Address *toAddr, Message &message)
+{
+	char *frame = emulNet->ENgetFrame(message.maxSize(), EN_LAYER_MP2, message.type);
+	int size = message.serialize(frame);
+	emulNet->ENsendFrame(&memberNode->addr, toAddr, frame, size);
 }
 /**
  * FUNCTION NAME: generateCRUDId, decipherCRUDId
@@ -201,10 +214,6 @@ MessageType MP2Node::decipherCRUDId(int CRUDId, int &transID)
 	// Mask the lower 29 bits 
 	return msgType; 
 }
-/**
- * Static map to store the KV pairs associated with transaction IDs.
- */
-static map<int, pair<string, string>> keyvalueMap;
 /**
  * FUNCTION NAME: clientCreate
  *
@@ -392,12 +401,12 @@ void MP2Node::checkMessages() {
 	while ( !memberNode->mp2q.empty() ) {
 		data = (char *)memberNode->mp2q.front().elt;
 		size = memberNode->mp2q.front().size;
+		q_elt elt = memberNode->mp2q.front();
 		memberNode->mp2q.pop();
-		//takes the C-style data string and converts it into a std::string object
-		//constructor of string class takes ptr to 1st elem const char* 
-		//and to the element just past the last char in the range we want to include. 
-		string messageStr(data, data + size);
-		Message message(messageStr);
+		// parse the fields in place, only key and value are copied out
+		Message message(data, size);
+		// hand the frame back to EmulNet
+		elt.release();
 		bool isStabilizationMessage = (message.type == CREATE || message.type == DELETE) && (message.replica == PRIMARY || message.replica == SECONDARY || message.replica==TERTIARY);
 		switch (message.type) 
 		{ 
@@ -406,7 +415,7 @@ void MP2Node::checkMessages() {
 				if(isStabilizationMessage)
 				{
 					createKeyValue(message.key, message.value, message.transID);
-					cout<<"STABILIZATION protocol CREATE called"<<endl;
+					log->print("STABILIZATION protocol CREATE called");
 				}
 				else
 				{
@@ -414,7 +423,7 @@ void MP2Node::checkMessages() {
 					MessageType msgType=decipherCRUDId(message.transID, transID);
 					bool success= createKeyValue(message.key, message.value, transID);
 					Message replyMessage(message.transID, memberNode->addr, REPLY, success);
-					emulNet->ENsend(&memberNode->addr, &message.fromAddr, replyMessage.toString());
+					sendMessage(&message.fromAddr, replyMessage);
 				}
 			}
 			break; 
@@ -425,7 +434,7 @@ void MP2Node::checkMessages() {
 				MessageType msgType=decipherCRUDId(message.transID, transID);
 				string value=readKey(message.key, transID);				
 				Message replyMessage(message.transID, memberNode->addr, value);
-				emulNet->ENsend(&memberNode->addr, &message.fromAddr,replyMessage.toString());
+				sendMessage(&message.fromAddr, replyMessage);
 			} 
 			break; 
 			
@@ -435,7 +444,7 @@ void MP2Node::checkMessages() {
 				MessageType msgType=decipherCRUDId(message.transID, transID);
 				bool success = updateKeyValue(message.key, message.value, transID);
 				Message replyMessage(message.transID, memberNode->addr, REPLY, success);
-				emulNet->ENsend(&memberNode->addr, &message.fromAddr,replyMessage.toString());				
+				sendMessage(&message.fromAddr, replyMessage);				
 			}  
 			break; 
 			
@@ -444,7 +453,7 @@ void MP2Node::checkMessages() {
 				if(isStabilizationMessage)
 				{
 					deletekey(message.key, message.transID);
-					cout<<"STABILIZATION protocol DELETE called"<<endl;
+					log->print("STABILIZATION protocol DELETE called");
 				}
 				else
 				{
@@ -452,7 +461,7 @@ void MP2Node::checkMessages() {
 					MessageType msgType=decipherCRUDId(message.transID, transID);
 					bool success=deletekey(message.key, transID);
 					Message replyMessage(message.transID, memberNode->addr, REPLY, success);
-					emulNet->ENsend(&memberNode->addr, &message.fromAddr, replyMessage.toString());
+					sendMessage(&message.fromAddr, replyMessage);
 				}
 			}
 			break; 
@@ -515,7 +524,7 @@ void MP2Node::checkMessages() {
 				}
 				else if (replyCountMap[message.transID]==expectedReplies) 
 				{
-					cout << "All replies received, logging failure if quorum not met" << endl;
+					log->print("All replies received, logging failure if quorum not met");
 					if(successCountMap[transID] < quorumValue)
 					{ 
 					if (msgType == CREATE) 
@@ -560,7 +569,7 @@ void MP2Node::checkMessages() {
 				}
 				else
 				{
-					cout<<"key not found in coordinator's keyvalueMap"<<endl;
+					log->print("key not found in coordinator's keyvalueMap");
 				}
 				bool success = message.value.empty() ? false : true;
 				// Initialize maps if transaction ID is new 
@@ -589,7 +598,7 @@ void MP2Node::checkMessages() {
 				}
 				else if (replyCountMap[message.transID]==expectedReplies) 
 				{
-					cout << "All replies received, logging failure if quorum not met" << endl;
+					log->print("All replies received, logging failure if quorum not met");
 					if(successCountMap[transID] < quorumValue)
 					log->logReadFail(&memberNode->addr, true, transID, key);
 					logged=true;
@@ -626,7 +635,7 @@ void MP2Node::checkMessages() {
         } else if (msgType == UPDATE) {
         log->logUpdateFail(&memberNode->addr, true, dechipheredTransID, key, value);
         }
-		else {cout<<"Unknown message type"<<endl;}        
+		else {log->print("Unknown message type");}        
     }
 	}
 	
@@ -675,7 +684,7 @@ bool MP2Node::recvLoop() {
     	return false;
     }
     else {
-    	return emulNet->ENrecv(&(memberNode->addr), this->enqueueWrapper, NULL, 1, &(memberNode->mp2q));
+    	return emulNet->ENrecv(&(memberNode->addr), this->enqueueWrapper, NULL, 1, &(memberNode->mp2q), EN_LAYER_MP2);
     }
 }
 
@@ -686,31 +695,27 @@ bool MP2Node::recvLoop() {
  */
 int MP2Node::enqueueWrapper(void *env, char *buff, int size) {
 	Queue q;
-	return q.enqueue((queue<q_elt> *)env, (void *)buff, size);
+	return q.enqueue((queue<q_elt> *)env, (void *)buff, size, EmulNet::ENframeOf(buff));
 }
 
 //functions for the stabilization protocol
 int MP2Node::generateTransactionID() 
 { 
-	return g_transID++; 
+	return stabilizationTransID++; 
 }
 void MP2Node::sendReplicateMessage(Node newReplicaNode, string key, string value, ReplicaType replicaType) 
 {
 	int transID = generateTransactionID();
 	Message replicateMessage(transID, memberNode->addr, CREATE, key, value, replicaType);
-	// Serialize the message to a string 
-	string serializedMessage = replicateMessage.toString();
-	emulNet->ENsend(&memberNode->addr, newReplicaNode.getAddress(), serializedMessage);
-	cout<<"SendReplicateMessage called from stabilization protocol"<<endl; 	
+	sendMessage(newReplicaNode.getAddress(), replicateMessage);
+	log->print("SendReplicateMessage called from stabilization protocol"); 	
 }
 void MP2Node::sendDeleteMessage(Node excessNode, string key)
 {
 	int transID = generateTransactionID();
 	Message replicateMessage(transID, memberNode->addr, DELETE, key);
-	// Serialize the message to a string 
-	string serializedMessage = replicateMessage.toString();
-	emulNet->ENsend(&memberNode->addr, excessNode.getAddress(), serializedMessage);
-	cout<<"SendDeleteMessage called from stabilization protocol"<<endl;
+	sendMessage(excessNode.getAddress(), replicateMessage);
+	log->print("SendDeleteMessage called from stabilization protocol");
 }
 
 //helper function
@@ -751,15 +756,15 @@ void MP2Node::stabilizationProtocol()
 		string value = entry.second;
 		//find the nodes that contain this key including the original node and the next two nodes
 		vector<Node> replicas = findNodes(key);
-		cout << "Old replicas: ";
+		string oldHashes, newHashes;
         for (auto& node : oldHasMyReplicas) {
-            cout << node.getHashCode() << " ";
+            oldHashes += to_string(node.getHashCode()) + " ";
         }
-		 cout << "\nNew replicas: ";
         for (auto& node : replicas) {
-            cout << node.getHashCode() << " ";
+            newHashes += to_string(node.getHashCode()) + " ";
         }
-        cout << endl;
+        log->print("Old replicas: %s", oldHashes.c_str());
+        log->print("New replicas: %s", newHashes.c_str());
 		// Check if current node should hold this key
         Node currentNode = Node(memberNode->addr);
         if (std::find_if(replicas.begin(), replicas.end(), [&currentNode](Node& node) {
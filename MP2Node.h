@@ -47,6 +47,10 @@ private:
 	EmulNet * emulNet;
 	// Object of Log
 	Log * log;
+	// KV pairs of the transactions this node coordinates, by transaction ID
+	map<int, pair<string, string>> keyvalueMap;
+	// transaction IDs of the stabilization messages sent by this node
+	int stabilizationTransID;
 
 public:
 	MP2Node(Member *memberNode, Params *par, EmulNet *emulNet, Log *log, Address *addressOfMember);
@@ -85,6 +89,7 @@ public:
 
 	// coordinator dispatches messages to corresponding nodes
 	void dispatchMessages(Message message);
+	void sendMessage(Address *toAddr, Message &message);
 
 	// find the addresses of nodes that are responsible for a key
 	vector<Node> findNodes(string key);
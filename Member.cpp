@@ -5,11 +5,36 @@
  **********************************/
 
 #include "Member.h"
+#include "FramePool.h"
+
+/**
+ * Constructor
+ *
+ * elt is not a pooled frame, the caller keeps ownership of it
+ */
+q_elt::q_elt(void *elt, int size): elt(elt), size(size), frame(NULL) {}
 
 /**
  * Constructor
  */
-q_elt::q_elt(void *elt, int size): elt(elt), size(size) {}
+q_elt::q_elt(void *elt, int size, void *frame): elt(elt), size(size), frame(frame) {}
+
+/**
+ * FUNCTION NAME: release
+ *
+ * DESCRIPTION: Drop this element's hold on the frame.
+ * 				Called once the node layer is done with the message.
+ * 				Nothing to do for an element without a pooled frame.
+ */
+void q_elt::release() {
+	if ( NULL == frame ) {
+		return;
+	}
+	FramePool::release(frame);
+	frame = NULL;
+	elt = NULL;
+	size = 0;
+}
 
 /**
  * Copy constructor
@@ -38,12 +63,12 @@ bool Address::operator ==(const Address& anotherAddress) {
 /**
  * Constructor
  */
-MemberListEntry::MemberListEntry(int id, short port, long heartbeat, long timestamp): id(id), port(port), heartbeat(heartbeat), timestamp(timestamp) {}
+MemberListEntry::MemberListEntry(int id, short port, long heartbeat, long timestamp): id(id), port(port), heartbeat(heartbeat), timestamp(timestamp), incarnation(0), state(MEMBER_ALIVE) {}
 
 /**
  * Constuctor
  */
-MemberListEntry::MemberListEntry(int id, short port): id(id), port(port) {}
+MemberListEntry::MemberListEntry(int id, short port): id(id), port(port), incarnation(0), state(MEMBER_ALIVE) {}
 
 /**
  * Copy constructor
@@ -53,6 +78,8 @@ MemberListEntry::MemberListEntry(const MemberListEntry &anotherMLE) {
 	this->id = anotherMLE.id;
 	this->port = anotherMLE.port;
 	this->timestamp = anotherMLE.timestamp;
+	this->incarnation = anotherMLE.incarnation;
+	this->state = anotherMLE.state;
 }
 
 /**
@@ -64,6 +91,8 @@ MemberListEntry& MemberListEntry::operator =(const MemberListEntry &anotherMLE)
 	swap(id, temp.id);
 	swap(port, temp.port);
 	swap(timestamp, temp.timestamp);
+	swap(incarnation, temp.incarnation);
+	swap(state, temp.state);
 	return *this;
 }
 
@@ -153,6 +182,7 @@ Member::Member(const Member &anotherMember) {
 	this->timeOutCounter = anotherMember.timeOutCounter;
 	this->memberList = anotherMember.memberList;
 	this->myPos = anotherMember.myPos;
+	this->memberIndex = anotherMember.memberIndex;
 	this->mp1q = anotherMember.mp1q;
 	this->mp2q = anotherMember.mp2q;
 }
@@ -171,6 +201,7 @@ Member& Member::operator =(const Member& anotherMember) {
 	this->timeOutCounter = anotherMember.timeOutCounter;
 	this->memberList = anotherMember.memberList;
 	this->myPos = anotherMember.myPos;
+	this->memberIndex = anotherMember.memberIndex;
 	this->mp1q = anotherMember.mp1q;
 	this->mp2q = anotherMember.mp2q;
 	return *this;
@@ -16,9 +16,14 @@
  */
 class q_elt {
 public:
+	// message bytes, read in place inside frame
 	void *elt;
 	int size;
+	// pooled frame handed over by EmulNet, held by this element until release(), NULL if none
+	void *frame;
 	q_elt(void *elt, int size);
+	q_elt(void *elt, int size, void *frame);
+	void release();
 };
 
 /**
@@ -54,6 +59,16 @@ public:
 	}
 };
 
+/**
+ * States of a member, SWIM style. A suspected member stays in the list until the
+ * suspicion is confirmed or refuted, a confirmed one is removed.
+ */
+enum MemberStates{
+	MEMBER_ALIVE,
+	MEMBER_SUSPECT,
+	MEMBER_CONFIRMED
+};
+
 /**
  * CLASS NAME: MemberListEntry
  *
@@ -65,9 +80,13 @@ public:
 	short port;
 	long heartbeat;
 	long timestamp;
+	// bumped only by the member itself, to refute a suspicion of it
+	int incarnation;
+	// one of MemberStates
+	char state;
 	MemberListEntry(int id, short port, long heartbeat, long timestamp);
 	MemberListEntry(int id, short port);
-	MemberListEntry(): id(0), port(0), heartbeat(0), timestamp(0) {}
+	MemberListEntry(): id(0), port(0), heartbeat(0), timestamp(0), incarnation(0), state(MEMBER_ALIVE) {}
 	MemberListEntry(const MemberListEntry &anotherMLE);
 	MemberListEntry& operator =(const MemberListEntry &anotherMLE);
 	int getid();
@@ -108,6 +127,8 @@ public:
 	vector<MemberListEntry> memberList;
 	// My position in the membership table
 	vector<MemberListEntry>::iterator myPos;
+	// position in memberList of each entry, keyed by MP1Node::memberKey(id, port)
+	unordered_map<unsigned long long, size_t> memberIndex;
 	// Queue for failure detection messages
 	queue<q_elt> mp1q;
 	// Queue for KVstore messages
@@ -0,0 +1,288 @@
+/**********************************
+ * FILE NAME: MemberCodec.cpp
+ *
+ * DESCRIPTION: Definition of the MemberWriter and MemberReader classes
+ **********************************/
+
+#include "MemberCodec.h"
+
+/**
+ * Constructor of the MemberWriter class, encodes a message of at most limit bytes
+ * at the start of buf. Ages of entries are counted from now.
+ */
+MemberWriter::MemberWriter(vector<char> &buf, int limit, long now): buf(buf), limit(limit), pos(0), now(now), lastHeartbeat(0), countPos(-1), count(0) {}
+
+/**
+ * FUNCTION NAME: grow
+ *
+ * DESCRIPTION: Make room for bytes more bytes. The buffer at least doubles, so a
+ * 				reused one soon stops growing.
+ */
+void MemberWriter::grow(int bytes) {
+	if ( pos + bytes > (int)buf.size() ) {
+		buf.resize(max(2 * buf.size(), (size_t)(pos + bytes)));
+	}
+}
+
+/**
+ * FUNCTION NAME: putByte
+ *
+ * DESCRIPTION: Append the low byte of value
+ */
+void MemberWriter::putByte(int value) {
+	buf[pos++] = (char)(value & 0xff);
+}
+
+/**
+ * FUNCTION NAME: putVarint
+ *
+ * DESCRIPTION: Append value 7 bits at a time, low bits first, the high bit of a
+ * 				byte set when more follow
+ */
+void MemberWriter::putVarint(unsigned long long value) {
+	while ( value >= 0x80 ) {
+		putByte((int)(value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+	putByte((int)value);
+}
+
+/**
+ * FUNCTION NAME: putAddress
+ *
+ * DESCRIPTION: Append the id and port of addr
+ */
+void MemberWriter::putAddress(Address *addr) {
+	int id;
+	short port;
+	memcpy(&id, &addr->addr[0], sizeof(int));
+	memcpy(&port, &addr->addr[4], sizeof(short));
+	putVarint((unsigned int)id);
+	putVarint((unsigned short)port);
+}
+
+/**
+ * FUNCTION NAME: putHeader
+ *
+ * DESCRIPTION: Start the message. other may be NULL.
+ */
+void MemberWriter::putHeader(int type, int flags, int ttl, Address *sender, Address *other, int seq) {
+	if ( other ) {
+		flags |= WIRE_HAS_OTHER;
+	}
+	grow(WIRE_MAX_HEADER);
+	putByte(MP1_WIRE_VERSION);
+	putByte(type);
+	putByte(flags);
+	putByte(ttl);
+	putAddress(sender);
+	if ( other ) {
+		putAddress(other);
+	}
+	putVarint((unsigned int)seq);
+	countPos = pos;
+	putByte(0);
+	putByte(0);
+}
+
+/**
+ * FUNCTION NAME: putEntry
+ *
+ * DESCRIPTION: Append entry with its delta kind
+ *
+ * RETURNS:
+ * false if the message may not have room for it within limit, nothing is written then
+ */
+bool MemberWriter::putEntry(const MemberListEntry &entry, int kind) {
+	if ( full() || count >= 0xffff ) {
+		return false;
+	}
+	grow(WIRE_MAX_ENTRY);
+	int flags = (kind & WIRE_KIND_MASK) | ((entry.state << WIRE_STATE_SHIFT) & WIRE_STATE_MASK);
+	if ( entry.incarnation != 0 ) {
+		flags |= WIRE_HAS_INCARNATION;
+	}
+	putVarint((unsigned int)entry.id);
+	putVarint((unsigned short)entry.port);
+	putByte(flags);
+	if ( entry.incarnation != 0 ) {
+		putVarint((unsigned int)entry.incarnation);
+	}
+	// heartbeats of a group are close to each other, the difference is mostly one byte
+	long long delta = (long long)entry.heartbeat - lastHeartbeat;
+	putVarint(((unsigned long long)delta << 1) ^ (unsigned long long)(delta >> 63));
+	lastHeartbeat = entry.heartbeat;
+	putVarint(now > entry.timestamp ? (unsigned long long)(now - entry.timestamp) : 0);
+	count++;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: full
+ *
+ * DESCRIPTION: Whether the message may not have room for one more entry
+ */
+bool MemberWriter::full() {
+	return room() < WIRE_MAX_ENTRY;
+}
+
+/**
+ * FUNCTION NAME: room
+ *
+ * DESCRIPTION: Bytes the message may still grow by
+ */
+int MemberWriter::room() {
+	return limit - pos;
+}
+
+/**
+ * FUNCTION NAME: finish
+ *
+ * DESCRIPTION: Patch the entry count into the header. The message is the first
+ * 				size bytes of the buffer.
+ *
+ * RETURNS:
+ * size of the message
+ */
+int MemberWriter::finish() {
+	buf[countPos] = (char)(count & 0xff);
+	buf[countPos + 1] = (char)(count >> 8);
+	return pos;
+}
+
+/**
+ * Constructor of the MemberReader class, decodes size bytes at data. Ages of
+ * entries are counted back from now.
+ */
+MemberReader::MemberReader(const char *data, int size, long now): data((const unsigned char *)data), size(size), pos(0), now(now), lastHeartbeat(0), left(0) {}
+
+/**
+ * FUNCTION NAME: getByte
+ *
+ * RETURNS:
+ * false at the end of the message
+ */
+bool MemberReader::getByte(int *value) {
+	if ( pos >= size ) {
+		return false;
+	}
+	*value = data[pos++];
+	return true;
+}
+
+/**
+ * FUNCTION NAME: getVarint
+ *
+ * RETURNS:
+ * false at the end of the message or on a varint longer than 64 bits
+ */
+bool MemberReader::getVarint(unsigned long long *value) {
+	*value = 0;
+	for ( int shift = 0; shift < 64; shift += 7 ) {
+		int byte;
+		if ( !getByte(&byte) ) {
+			return false;
+		}
+		*value |= (unsigned long long)(byte & 0x7f) << shift;
+		if ( 0 == (byte & 0x80) ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: getAddress
+ *
+ * RETURNS:
+ * false at the end of the message
+ */
+bool MemberReader::getAddress(Address *addr) {
+	unsigned long long id, port;
+	if ( !getVarint(&id) || !getVarint(&port) ) {
+		return false;
+	}
+	int i = (int)id;
+	short p = (short)port;
+	memcpy(&addr->addr[0], &i, sizeof(int));
+	memcpy(&addr->addr[4], &p, sizeof(short));
+	return true;
+}
+
+/**
+ * FUNCTION NAME: getHeader
+ *
+ * DESCRIPTION: Decode the header, the entries are read next with nextEntry
+ *
+ * RETURNS:
+ * false if the message is of another version or cut short
+ */
+bool MemberReader::getHeader(WireHeader *hdr) {
+	unsigned long long seq;
+	int low, high;
+	if ( !getByte(&hdr->version) || MP1_WIRE_VERSION != hdr->version ) {
+		return false;
+	}
+	if ( !getByte(&hdr->type) || !getByte(&hdr->flags) || !getByte(&hdr->ttl) ) {
+		return false;
+	}
+	if ( !getAddress(&hdr->sender) ) {
+		return false;
+	}
+	hdr->other.init();
+	if ( (hdr->flags & WIRE_HAS_OTHER) && !getAddress(&hdr->other) ) {
+		return false;
+	}
+	if ( !getVarint(&seq) || !getByte(&low) || !getByte(&high) ) {
+		return false;
+	}
+	hdr->seq = (int)seq;
+	hdr->count = low | (high << 8);
+	left = hdr->count;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: nextEntry
+ *
+ * DESCRIPTION: Decode the next entry and its delta kind. The timestamp is now
+ * 				less the age it was sent with.
+ *
+ * RETURNS:
+ * false once all entries were read or the message is cut short
+ */
+bool MemberReader::nextEntry(MemberListEntry *entry, int *kind) {
+	unsigned long long id, port, incarnation = 0, zigzag, age;
+	int flags;
+	if ( left <= 0 ) {
+		return false;
+	}
+	if ( !getVarint(&id) || !getVarint(&port) || !getByte(&flags) ) {
+		left = 0;
+		return false;
+	}
+	if ( (flags & WIRE_HAS_INCARNATION) && !getVarint(&incarnation) ) {
+		left = 0;
+		return false;
+	}
+	if ( !getVarint(&zigzag) || !getVarint(&age) ) {
+		left = 0;
+		return false;
+	}
+	lastHeartbeat += (long)(zigzag >> 1) ^ -(long)(zigzag & 1);
+	*entry = MemberListEntry((int)id, (short)port, lastHeartbeat, now - (long)age);
+	entry->incarnation = (int)incarnation;
+	entry->state = (char)((flags & WIRE_STATE_MASK) >> WIRE_STATE_SHIFT);
+	*kind = flags & WIRE_KIND_MASK;
+	left--;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: setTtl
+ *
+ * DESCRIPTION: Change the ttl of an encoded message in place
+ */
+void MemberReader::setTtl(char *frame, int ttl) {
+	frame[WIRE_FIXED_HEADER - 1] = (char)ttl;
+}
@@ -0,0 +1,112 @@
+/**********************************
+ * FILE NAME: MemberCodec.h
+ *
+ * DESCRIPTION: Wire format of the membership protocol messages
+ **********************************/
+
+#ifndef MEMBERCODEC_H_
+#define MEMBERCODEC_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+
+/*
+ * Macros
+ */
+// first byte of every MP1 message, a frame of any other version is dropped
+#define MP1_WIRE_VERSION 1
+// version, type, flags and ttl bytes ahead of the addresses
+#define WIRE_FIXED_HEADER 4
+// most bytes a header takes: the fixed part, two addresses, seq and the entry count
+#define WIRE_MAX_HEADER (WIRE_FIXED_HEADER + 2 * (5 + 3) + 5 + 2)
+// most bytes an entry takes: id, port, flags, incarnation, heartbeat and age
+#define WIRE_MAX_ENTRY (5 + 3 + 1 + 5 + 10 + 10)
+// fewest bytes an entry takes
+#define WIRE_MIN_ENTRY 5
+// header flags
+#define WIRE_FROM_PINGREQ 0x01
+#define WIRE_HAS_OTHER 0x02
+// entry flags: delta kind in bits 0-1, member state in bits 2-3
+#define WIRE_KIND_MASK 0x03
+#define WIRE_STATE_SHIFT 2
+#define WIRE_STATE_MASK 0x0c
+#define WIRE_HAS_INCARNATION 0x10
+
+/**
+ * STRUCT NAME: WireHeader
+ *
+ * DESCRIPTION: Decoded header of an MP1 message. other is the null address unless
+ * 				flags has WIRE_HAS_OTHER.
+ */
+typedef struct WireHeader {
+	int version;
+	int type;
+	int flags;
+	int ttl;
+	Address sender;
+	Address other;
+	int seq;
+	// entries that follow the header
+	int count;
+}WireHeader;
+
+/**
+ * CLASS NAME: MemberWriter
+ *
+ * DESCRIPTION: Encodes an MP1 message in one pass into a buffer that grows as
+ * 				needed, so one buffer can be reused for every message. The header is
+ * 				the version, type, flags and ttl bytes, the sender and, if given,
+ * 				the other address as varint id and port, a varint seq, then a 2-byte
+ * 				little endian count of the entries that follow, patched in by finish.
+ * 				An entry is a varint id and port, a flags byte with its delta kind
+ * 				and state, a varint incarnation if not 0, the zigzag varint of its
+ * 				heartbeat minus the one of the entry before, and the varint ticks
+ * 				since its timestamp.
+ */
+class MemberWriter {
+private:
+	vector<char> &buf;
+	int limit;
+	int pos;
+	long now;
+	long lastHeartbeat;
+	int countPos;
+	int count;
+	void putByte(int value);
+	void putVarint(unsigned long long value);
+	void putAddress(Address *addr);
+	void grow(int bytes);
+public:
+	MemberWriter(vector<char> &buf, int limit, long now);
+	void putHeader(int type, int flags, int ttl, Address *sender, Address *other, int seq);
+	bool putEntry(const MemberListEntry &entry, int kind);
+	bool full();
+	int room();
+	int finish();
+};
+
+/**
+ * CLASS NAME: MemberReader
+ *
+ * DESCRIPTION: Decodes what MemberWriter wrote. Every read is bounds checked, so
+ * 				a damaged frame only ends the decoding early.
+ */
+class MemberReader {
+private:
+	const unsigned char *data;
+	int size;
+	int pos;
+	long now;
+	long lastHeartbeat;
+	int left;
+	bool getByte(int *value);
+	bool getVarint(unsigned long long *value);
+	bool getAddress(Address *addr);
+public:
+	MemberReader(const char *data, int size, long now);
+	bool getHeader(WireHeader *hdr);
+	bool nextEntry(MemberListEntry *entry, int *kind);
+	static void setTtl(char *frame, int ttl);
+};
+
+#endif /* MEMBERCODEC_H_ */
@@ -14,43 +14,85 @@
 // transID::fromAddr::DELETE::key
 // transID::fromAddr::REPLY::sucess
 // transID::fromAddr::READREPLY::value
-Message::Message(string message){
+Message::Message(string message): Message(message.data(), (int)message.size()) {}
+
+/**
+ * FUNCTION NAME: parseInt
+ *
+ * DESCRIPTION: Parse a decimal field that is not NUL terminated
+ */
+static int parseInt(const char *field, int length) {
+	int i = 0;
+	int sign = 1;
+	int value = 0;
+	if ( length > 0 && field[0] == '-' ) {
+		sign = -1;
+		i++;
+	}
+	for ( ; i < length && field[i] >= '0' && field[i] <= '9'; i++ ) {
+		value = value * 10 + (field[i] - '0');
+	}
+	return sign * value;
+}
+
+/**
+ * Constructor
+ *
+ * Same format as the string constructor, but the fields are located in the
+ * frame itself so only key and value are copied out.
+ */
+Message::Message(const char *data, int size){
 	this->delimiter = "::";
-	vector<string> tuple;
-	size_t pos = message.find(delimiter);
-	size_t start = 0;
-	while (pos != string::npos) {
-		string field = message.substr(start, pos-start);
-		tuple.push_back(field);
+	replica = NO_REPLICA;
+	success = false;
+	const char *field[6];
+	int length[6];
+	int count = 0;
+	const char *start = data;
+	const char *end = data + size;
+	while ( count < 6 ) {
+		const char *pos = start;
+		while ( pos + 1 < end && !(pos[0] == ':' && pos[1] == ':') ) {
+			pos++;
+		}
+		field[count] = start;
+		if ( pos + 1 >= end ) {
+			length[count++] = end - start;
+			break;
+		}
+		length[count++] = pos - start;
 		start = pos + 2;
-		pos = message.find(delimiter, start);
 	}
-	tuple.push_back(message.substr(start));
 
-	transID = stoi(tuple.at(0));
-	Address addr(tuple.at(1));
-	fromAddr = addr;
-	type = static_cast<MessageType>(stoi(tuple.at(2)));
+	transID = parseInt(field[0], length[0]);
+	// fromAddr is id:port
+	const char *colon = (const char *)memchr(field[1], ':', length[1]);
+	int idLength = colon ? colon - field[1] : length[1];
+	int id = parseInt(field[1], idLength);
+	short port = colon ? (short)parseInt(colon + 1, length[1] - idLength - 1) : 0;
+	memcpy(&fromAddr.addr[0], &id, sizeof(int));
+	memcpy(&fromAddr.addr[4], &port, sizeof(short));
+	type = static_cast<MessageType>(parseInt(field[2], length[2]));
 	switch(type){
 		case CREATE:
 		case UPDATE:
-			key = tuple.at(3);
-			value = tuple.at(4);
-			if (tuple.size() > 5)
-				replica = static_cast<ReplicaType>(stoi(tuple.at(5)));
+			key.assign(field[3], length[3]);
+			value.assign(field[4], length[4]);
+			if (count > 5)
+				replica = static_cast<ReplicaType>(parseInt(field[5], length[5]));
 			break;
 		case READ:
 		case DELETE:
-			key = tuple.at(3);
+			key.assign(field[3], length[3]);
 			break;
 		case REPLY:
-			if (tuple.at(3) == "1")
+			if (length[3] == 1 && field[3][0] == '1')
 				success = true;
 			else
 				success = false;
 			break;
 		case READREPLY:
-			value = tuple.at(3);
+			value.assign(field[3], length[3]);
 			break;
 	}
 }
@@ -67,6 +109,7 @@ Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key
 	key = _key;
 	value = _value;
 	replica = _replica;
+	success = false;
 }
 
 /**
@@ -88,6 +131,8 @@ Message::Message(const Message& anotherMessage) {
  */
 Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value){
 	this->delimiter = "::";
+	replica = NO_REPLICA;
+	success = false;
 	transID = _transID;
 	fromAddr = _fromAddr;
 	type = _type;
@@ -101,6 +146,8 @@ Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key
 // construct a read or delete message
 Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key){
 	this->delimiter = "::";
+	replica = NO_REPLICA;
+	success = false;
 	transID = _transID;
 	fromAddr = _fromAddr;
 	type = _type;
@@ -113,6 +160,7 @@ Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key
 // construct reply message
 Message::Message(int _transID, Address _fromAddr, MessageType _type, bool _success){
 	this->delimiter = "::";
+	replica = NO_REPLICA;
 	transID = _transID;
 	fromAddr = _fromAddr;
 	type = _type;
@@ -125,6 +173,8 @@ Message::Message(int _transID, Address _fromAddr, MessageType _type, bool _succe
 // construct read reply message
 Message::Message(int _transID, Address _fromAddr, string _value){
 	this->delimiter = "::";
+	replica = NO_REPLICA;
+	success = false;
 	transID = _transID;
 	fromAddr = _fromAddr;
 	type = READREPLY;
@@ -160,6 +210,58 @@ string Message::toString(){
 	return message;
 }
 
+/**
+ * FUNCTION NAME: maxSize
+ *
+ * DESCRIPTION: Upper bound of the serialized size: key and value plus room for the
+ * 				numeric fields, the address and the delimiters
+ */
+int Message::maxSize(){
+	return 64 + 5 * delimiter.size() + key.size() + value.size();
+}
+
+/**
+ * FUNCTION NAME: serialize
+ *
+ * DESCRIPTION: Write the same bytes as toString() straight into buf
+ *
+ * RETURNS:
+ * number of bytes written
+ */
+int Message::serialize(char *buf){
+	int id = 0;
+	short port = 0;
+	const char *delim = delimiter.c_str();
+	memcpy(&id, &fromAddr.addr[0], sizeof(int));
+	memcpy(&port, &fromAddr.addr[4], sizeof(short));
+	char *ptr = buf;
+	ptr += sprintf(ptr, "%d%s%d:%d%s%d%s", transID, delim, id, port, delim, type, delim);
+	switch(type){
+		case CREATE:
+		case UPDATE:
+			memcpy(ptr, key.data(), key.size());
+			ptr += key.size();
+			ptr += sprintf(ptr, "%s", delim);
+			memcpy(ptr, value.data(), value.size());
+			ptr += value.size();
+			ptr += sprintf(ptr, "%s%d", delim, replica);
+			break;
+		case READ:
+		case DELETE:
+			memcpy(ptr, key.data(), key.size());
+			ptr += key.size();
+			break;
+		case REPLY:
+			*ptr++ = success ? '1' : '0';
+			break;
+		case READREPLY:
+			memcpy(ptr, value.data(), value.size());
+			ptr += value.size();
+			break;
+	}
+	return ptr - buf;
+}
+
 /**
  * Assignment operator overloading
  */
@@ -28,6 +28,8 @@ public:
 	string delimiter;
 	// construct a message from a string
 	Message(string message);
+	// construct a message from a received frame, read in place
+	Message(const char *data, int size);
 	Message(const Message& anotherMessage);
 	// construct a create or update message
 	Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value);
@@ -41,6 +43,10 @@ public:
 	Message& operator = (const Message& anotherMessage);
 	// serialize to a string
 	string toString();
+	// upper bound of the serialized size
+	int maxSize();
+	// serialize into buf, which holds at least maxSize() bytes
+	int serialize(char *buf);
 };
 
 #endif
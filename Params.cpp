@@ -9,7 +9,7 @@
 /**
  * Constructor
  */
-Params::Params(): PORTNUM(8001) {}
+Params::Params(): MAX_NNB(0), SINGLE_FAILURE(0), MSG_DROP_PROB(0), DROP_MSG(0), PORTNUM(8001), CRUDTEST(CREATE_TEST), EN_BUFFSIZE(ENBUFFSIZE), NUM_THREADS(1), SEED(time(NULL)), LATENCY(0), JITTER(0), LATENCY_DIST(UNIFORM_DIST), BANDWIDTH(0), UDP_BASE_PORT(20000), TICK_USEC(10000), TRANSPORT(UDP_TRANSPORT), COALESCE(0), FRAG_TIMEOUT(20), VALUE_SIZE(0), COMPRESS(0), COMPRESS_MIN(128), STATS_TEXT(0), SHARED_NET(1), INDIRECT_PROBERS(2), SLOW_NODES(0), SLOW_PERIOD(1), rngStreams(0) {}
 
 /**
  * FUNCTION NAME: setparams
@@ -18,14 +18,93 @@ Params::Params(): PORTNUM(8001) {}
  */
 void Params::setparams(char *config_file) {
 	//trace.funcEntry("Params::setparams");
-	char CRUD[10];
+	char line[256];
+	char name[64];
+	char value[64];
+	char CRUD[64] = "";
 	FILE *fp = fopen(config_file,"r");
 
-	fscanf(fp,"MAX_NNB: %d", &MAX_NNB);
-	fscanf(fp,"\nSINGLE_FAILURE: %d", &SINGLE_FAILURE);
-	fscanf(fp,"\nDROP_MSG: %d", &DROP_MSG);
-	fscanf(fp,"\nMSG_DROP_PROB: %lf", &MSG_DROP_PROB);
-	fscanf(fp,"\nCRUD_TEST: %s", CRUD);
+	// one "KEY: value" pair per line, in any order; missing keys keep their defaults
+	while ( NULL != fp && NULL != fgets(line, sizeof(line), fp) ) {
+		if ( 2 != sscanf(line, " %63[^: ] : %63s", name, value) ) {
+			continue;
+		}
+		if ( 0 == strcmp(name, "MAX_NNB") ) {
+			MAX_NNB = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "SINGLE_FAILURE") ) {
+			SINGLE_FAILURE = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "DROP_MSG") ) {
+			DROP_MSG = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "MSG_DROP_PROB") ) {
+			MSG_DROP_PROB = atof(value);
+		}
+		else if ( 0 == strcmp(name, "CRUD_TEST") ) {
+			snprintf(CRUD, sizeof(CRUD), "%s", value);
+		}
+		else if ( 0 == strcmp(name, "EN_BUFFSIZE") ) {
+			EN_BUFFSIZE = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "NUM_THREADS") ) {
+			NUM_THREADS = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "SEED") ) {
+			SEED = strtoull(value, NULL, 10);
+		}
+		else if ( 0 == strcmp(name, "LATENCY") ) {
+			LATENCY = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "JITTER") ) {
+			JITTER = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "LATENCY_DIST") ) {
+			LATENCY_DIST = ( 0 == strcmp(value, "exponential") ) ? EXPONENTIAL_DIST : UNIFORM_DIST;
+		}
+		else if ( 0 == strcmp(name, "BANDWIDTH") ) {
+			BANDWIDTH = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "UDP_BASE_PORT") ) {
+			UDP_BASE_PORT = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "TICK_USEC") ) {
+			TICK_USEC = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "VALUE_SIZE") ) {
+			VALUE_SIZE = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "FRAG_TIMEOUT") ) {
+			FRAG_TIMEOUT = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "COMPRESS") ) {
+			COMPRESS = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "COMPRESS_MIN") ) {
+			COMPRESS_MIN = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "STATS_TEXT") ) {
+			STATS_TEXT = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "SHARED_NET") ) {
+			SHARED_NET = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "INDIRECT_PROBERS") ) {
+			INDIRECT_PROBERS = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "SLOW_NODES") ) {
+			SLOW_NODES = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "SLOW_PERIOD") ) {
+			SLOW_PERIOD = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "COALESCE") ) {
+			COALESCE = atoi(value);
+		}
+		else if ( 0 == strcmp(name, "TRANSPORT") ) {
+			TRANSPORT = ( 0 == strcmp(value, "shm") ) ? SHM_TRANSPORT : UDP_TRANSPORT;
+		}
+	}
 
 	if ( 0 == strcmp(CRUD, "CREATE") ) {
 		this->CRUDTEST = CREATE_TEST;
@@ -51,7 +130,9 @@ void Params::setparams(char *config_file) {
 	for ( unsigned int i = 0; i < EN_GPSZ; i++ ) {
 		allNodesJoined += i;
 	}
-	fclose(fp);
+	if ( NULL != fp ) {
+		fclose(fp);
+	}
 	//trace.funcExit("Params::setparams", SUCCESS);
 	return;
 }
@@ -65,3 +146,14 @@ void Params::setparams(char *config_file) {
 int Params::getcurrtime(){
     return globaltime;
 }
+
+/**
+ * FUNCTION NAME: newRandom
+ *
+ * DESCRIPTION: Hand out the next generator derived from SEED. Generators are created
+ * 				in a fixed order while the simulation is set up, so the same seed
+ * 				gives every owner the same sequence in every run.
+ */
+Random Params::newRandom() {
+	return Random(SEED, rngStreams++);
+}
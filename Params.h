@@ -10,8 +10,16 @@
 #include "stdincludes.h"
 #include "Params.h"
 #include "Member.h"
+#include "Random.h"
+
+// default number of messages EmulNet holds in flight
+#define ENBUFFSIZE 30000
 
 enum testTYPE { CREATE_TEST, READ_TEST, UPDATE_TEST, DELETE_TEST };
+// shape of the per-message jitter added to the link latency
+enum distTYPE { UNIFORM_DIST, EXPONENTIAL_DIST };
+// network UdpApplication runs its node processes on
+enum transportTYPE { UDP_TRANSPORT, SHM_TRANSPORT };
 
 /**
  * CLASS NAME: Params
@@ -32,9 +40,31 @@ public:
 	int allNodesJoined;
 	short PORTNUM;
 	int CRUDTEST;
+	int EN_BUFFSIZE;			// messages EmulNet holds in flight, 0 for no limit
+	int NUM_THREADS;			// threads running the node loops, 0 for one per core
+	unsigned long long SEED;	// master seed of all random generators
+	int LATENCY;				// ticks every message spends on a link
+	int JITTER;					// extra ticks per message: max (uniform) or mean (exponential)
+	int LATENCY_DIST;			// distribution of the jitter
+	int BANDWIDTH;				// bytes a link carries per tick, 0 for no limit
+	int UDP_BASE_PORT;			// UdpApplication: node n listens on UDP_BASE_PORT + n
+	int TICK_USEC;				// UdpApplication: wall clock length of a tick
+	int TRANSPORT;				// UdpApplication: loopback UDP or shared memory rings
+	int COALESCE;				// pack the frames sent on a link within a tick into one
+	int FRAG_TIMEOUT;			// ticks a partly received message waits for its missing fragments
+	int VALUE_SIZE;				// test values are padded to this many bytes
+	int COMPRESS;				// compress frame payloads with LzCodec
+	int COMPRESS_MIN;			// payloads shorter than this are sent as they are
+	int STATS_TEXT;				// also list the per node, per tick counters in msgcount.log
+	int SHARED_NET;				// MP1 and MP2 share one EmulNet, on channels of their own
+	int INDIRECT_PROBERS;		// proxies a ping request goes to, k of SWIM, up to MAX_INDIRECT_PROBERS
+	int SLOW_NODES;				// Application: the last SLOW_NODES nodes are overloaded and
+	int SLOW_PERIOD;			// only run their membership loop every SLOW_PERIOD ticks
+	int rngStreams;				// generators handed out so far
 	Params();
 	void setparams(char *);
 	int getcurrtime();
+	Random newRandom();
 };
 
 #endif /* _PARAMS_H_ */
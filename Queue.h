@@ -19,8 +19,9 @@ class Queue {
 public:
 	Queue() {}
 	virtual ~Queue() {}
-	static bool enqueue(queue<q_elt> *queue, void *buffer, int size) {
-		q_elt element(buffer, size);
+	// The element takes over the hold on frame, see q_elt::release()
+	static bool enqueue(queue<q_elt> *queue, void *buffer, int size, void *frame) {
+		q_elt element(buffer, size, frame);
 		queue->emplace(element);
 		return true;
 	}
@@ -0,0 +1,65 @@
+/**********************************
+ * FILE NAME: Random.h
+ *
+ * DESCRIPTION: Seedable pseudo random number generator
+ **********************************/
+
+#ifndef RANDOM_H_
+#define RANDOM_H_
+
+/**
+ * CLASS NAME: Random
+ *
+ * DESCRIPTION: xoshiro256** generator. Every user owns its own instance, so draws
+ * 				need no locking and do not depend on what other nodes draw. The
+ * 				state is expanded from a (seed, stream) pair with splitmix64, which
+ * 				gives unrelated sequences for neighbouring streams.
+ */
+class Random {
+private:
+	unsigned long long s[4];
+	static unsigned long long splitmix(unsigned long long &x) {
+		unsigned long long z = (x += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+	static unsigned long long rotl(unsigned long long x, int k) {
+		return (x << k) | (x >> (64 - k));
+	}
+public:
+	Random() {
+		seed(0, 0);
+	}
+	Random(unsigned long long seedValue, unsigned long long stream) {
+		seed(seedValue, stream);
+	}
+	void seed(unsigned long long seedValue, unsigned long long stream) {
+		unsigned long long x = seedValue ^ splitmix(stream);
+		for ( int i = 0; i < 4; i++ ) {
+			s[i] = splitmix(x);
+		}
+	}
+	// next 64 random bits
+	unsigned long long next() {
+		unsigned long long result = rotl(s[1] * 5, 7) * 9;
+		unsigned long long t = s[1] << 17;
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 45);
+		return result;
+	}
+	// uniform integer in [0, bound)
+	int nextInt(int bound) {
+		return (int)(((next() >> 32) * (unsigned long long)bound) >> 32);
+	}
+	// uniform double in [0, 1)
+	double nextDouble() {
+		return (next() >> 11) * (1.0 / 9007199254740992.0);
+	}
+};
+
+#endif /* RANDOM_H_ */
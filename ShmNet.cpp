@@ -0,0 +1,384 @@
+/**********************************
+ * FILE NAME: ShmNet.cpp
+ *
+ * DESCRIPTION: Definition of the ShmNet class
+ **********************************/
+
+#include "ShmNet.h"
+
+/**
+ * Constructor
+ */
+ShmNet::ShmNet(Params *p, int nodeId, int portBase): EmulNet(p) {
+	this->nodeId = nodeId;
+	this->portBase = portBase;
+	inbox = NULL;
+	inboxBytes = 0;
+	tickedUpTo = -1;
+	sentMsgs = 0;
+	sentBytes = 0;
+	ringFull = 0;
+	noPeer = 0;
+	recvMsgs = 0;
+	recvBytes = 0;
+}
+
+/**
+ * Destructor
+ */
+ShmNet::~ShmNet() {
+	for ( auto it = peers.begin(); it != peers.end(); ++it ) {
+		munmap(it->second, peerBytes[it->first]);
+	}
+	if ( NULL != inbox ) {
+		munmap(inbox, inboxBytes);
+		shm_unlink(segmentName(nodeId).c_str());
+	}
+}
+
+/**
+ * FUNCTION NAME: segmentName
+ *
+ * DESCRIPTION: Name of the inbox segment of node id in this network
+ */
+string ShmNet::segmentName(int id) {
+	char name[64];
+	snprintf(name, sizeof(name), "/emulnet_%d_%d", portBase, id);
+	return string(name);
+}
+
+/**
+ * FUNCTION NAME: cellAt
+ *
+ * DESCRIPTION: Cell that ring position pos maps to
+ */
+shm_cell *ShmNet::cellAt(shm_ring *ring, unsigned long long pos) {
+	return (shm_cell *)((char *)(ring + 1) + (pos & (ring->slots - 1)) * ring->stride);
+}
+
+/**
+ * FUNCTION NAME: mapRing
+ *
+ * DESCRIPTION: Create and map this node's inbox, or map the inbox of another node
+ *
+ * RETURNS:
+ * the ring, NULL if a peer's ring does not exist or is not set up yet
+ */
+shm_ring *ShmNet::mapRing(int id, bool create, size_t *bytes) {
+	string name = segmentName(id);
+	int fd;
+
+	if ( create ) {
+		// a segment left over by an earlier run is replaced, not reused
+		shm_unlink(name.c_str());
+		fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+		if ( fd < 0 ) {
+			return NULL;
+		}
+		unsigned int stride = (sizeof(shm_cell) + par->MAX_MSG_SIZE + SHM_CACHE_LINE - 1) & ~(SHM_CACHE_LINE - 1);
+		*bytes = sizeof(shm_ring) + (size_t)SHM_RING_SLOTS * stride;
+		if ( ftruncate(fd, *bytes) < 0 ) {
+			close(fd);
+			return NULL;
+		}
+		void *mem = mmap(NULL, *bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if ( MAP_FAILED == mem ) {
+			return NULL;
+		}
+
+		// the segment starts zeroed, magic stays 0 until every cell is set up
+		shm_ring *ring = (shm_ring *)mem;
+		ring->slots = SHM_RING_SLOTS;
+		ring->stride = stride;
+		ring->enqueuePos = 0;
+		ring->dequeuePos = 0;
+		for ( unsigned int i = 0; i < ring->slots; i++ ) {
+			cellAt(ring, i)->seq = i;
+		}
+		__atomic_store_n(&ring->magic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+		return ring;
+	}
+
+	fd = shm_open(name.c_str(), O_RDWR, 0600);
+	if ( fd < 0 ) {
+		return NULL;
+	}
+	struct stat st;
+	if ( fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(shm_ring) ) {
+		close(fd);
+		return NULL;
+	}
+	*bytes = st.st_size;
+	void *mem = mmap(NULL, *bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if ( MAP_FAILED == mem ) {
+		return NULL;
+	}
+	shm_ring *ring = (shm_ring *)mem;
+	if ( __atomic_load_n(&ring->magic, __ATOMIC_ACQUIRE) != SHM_RING_MAGIC ) {
+		munmap(mem, *bytes);
+		return NULL;
+	}
+	return ring;
+}
+
+/**
+ * FUNCTION NAME: peerRing
+ *
+ * DESCRIPTION: Inbox of node id, mapped on the first send to it
+ */
+shm_ring *ShmNet::peerRing(int id) {
+	auto it = peers.find(id);
+	if ( it != peers.end() ) {
+		return it->second;
+	}
+	size_t bytes;
+	shm_ring *ring = mapRing(id, false, &bytes);
+	if ( NULL != ring ) {
+		peers[id] = ring;
+		peerBytes[id] = bytes;
+	}
+	return ring;
+}
+
+/**
+ * FUNCTION NAME: ENinit
+ *
+ * DESCRIPTION: Give this process its node id and set up its inbox
+ */
+void *ShmNet::ENinit(Address *myaddr, short port) {
+	*(int *)(myaddr->addr) = nodeId;
+	*(short *)(&myaddr->addr[4]) = 0;
+
+	inbox = mapRing(nodeId, true, &inboxBytes);
+	if ( NULL == inbox ) {
+		perror("ShmNet inbox");
+		exit(1);
+	}
+	return myaddr;
+}
+
+/**
+ * FUNCTION NAME: ENsendFrame
+ *
+ * DESCRIPTION: Send a frame obtained from ENgetFrame to one node
+ *
+ * RETURNS:
+ * size, 0 if the message was dropped, -1 if the destination ring is full
+ */
+int ShmNet::ENsendFrame(Address *myaddr, Address *toaddr, char *data, int size) {
+	en_msg *em = (en_msg *)ENframeOf(data);
+
+	em->size = size;
+	memcpy(&(em->from.addr), &(myaddr->addr), sizeof(em->from.addr));
+	return sendTo(em, toaddr);
+}
+
+/**
+ * FUNCTION NAME: ENsendMulti
+ *
+ * DESCRIPTION: Copy one frame into the ring of every node of toList
+ *
+ * RETURNS:
+ * number of destinations the frame was put on the network for
+ */
+int ShmNet::ENsendMulti(Address *myaddr, vector<Address> &toList, char *data, int size) {
+	en_msg *em = (en_msg *)ENframeOf(data);
+	int sent = 0;
+
+	if ( toList.empty() ) {
+		FramePool::release(em);
+		return 0;
+	}
+
+	em->size = size;
+	memcpy(&(em->from.addr), &(myaddr->addr), sizeof(em->from.addr));
+	for ( unsigned int i = 1; i < toList.size(); i++ ) {
+		FramePool::retain(em);
+	}
+	for ( unsigned int i = 0; i < toList.size(); i++ ) {
+		if ( sendTo(em, &toList[i]) > 0 ) {
+			sent++;
+		}
+	}
+	return sent;
+}
+
+/**
+ * FUNCTION NAME: sendTo
+ *
+ * DESCRIPTION: Copy the frame into a cell of the destination's ring and drop one
+ * 				reference to it. Positions are claimed with a compare and swap on
+ * 				the ring's enqueue position, the cell is handed to the owner by
+ * 				storing its new seq.
+ *
+ * RETURNS:
+ * size, 0 if the message was dropped, -1 if the destination ring is full
+ */
+int ShmNet::sendTo(en_msg *em, Address *toaddr) {
+	int size = em->size;
+	char *data = (char *)(em + 1);
+	int time = par->getcurrtime();
+
+	if( (size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE) || (par->dropmsg && rng.nextInt(100) < (int) (par->MSG_DROP_PROB * 100)) ) {
+		FramePool::release(em);
+		return 0;
+	}
+
+	shm_ring *ring = peerRing(*(int *)(toaddr->addr));
+	if ( NULL == ring ) {
+		noPeer++;
+		FramePool::release(em);
+		return 0;
+	}
+
+	unsigned long long pos = __atomic_load_n(&ring->enqueuePos, __ATOMIC_RELAXED);
+	shm_cell *cell;
+	while ( true ) {
+		cell = cellAt(ring, pos);
+		unsigned long long seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+		long long diff = (long long)(seq - pos);
+		if ( 0 == diff ) {
+			if ( __atomic_compare_exchange_n(&ring->enqueuePos, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED) ) {
+				break;
+			}
+		}
+		else if ( diff < 0 ) {
+			// the owner has not caught up, same as a full EmulNet buffer
+			ringFull++;
+			fullMsgs++;
+			countMsg(full_msgs, nodeId, time, 1);
+			FramePool::release(em);
+			return -1;
+		}
+		else {
+			pos = __atomic_load_n(&ring->enqueuePos, __ATOMIC_RELAXED);
+		}
+	}
+
+	cell->size = size;
+	cell->from = nodeId;
+	cell->due = time + 1 + linkDelay(em, toaddr);
+	cell->layer = em->layer;
+	cell->type = em->type;
+	memcpy(cell + 1, data, size);
+	__atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+
+	countMsg(sent_msgs, nodeId, time, 1);
+	countTraffic(true, nodeId, time, em->layer, em->type, size);
+	FramePool::release(em);
+	copiedBytes += size;
+	sentMsgs++;
+	sentBytes += size;
+	return size;
+}
+
+/**
+ * FUNCTION NAME: ENrecv
+ *
+ * DESCRIPTION: Move everything the senders finished writing out of the inbox ring
+ * 				into pooled frames, then deliver what is due like EmulNet does
+ *
+ * RETURN:
+ * 0
+ */
+int ShmNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue, int channel) {
+	int time = par->getcurrtime();
+	unsigned long long pos = inbox->dequeuePos;
+
+	while ( true ) {
+		shm_cell *cell = cellAt(inbox, pos);
+		if ( __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != pos + 1 ) {
+			break;
+		}
+
+		en_msg *em = (en_msg *)pool.alloc(sizeof(en_msg) + cell->size);
+		em->size = cell->size;
+		memset(em->from.addr, 0, sizeof(em->from.addr));
+		memcpy(&em->from.addr[0], &cell->from, sizeof(int));
+		em->batch = 0;
+		em->frag = 0;
+		em->raw = 0;
+		em->layer = cell->layer;
+		em->type = cell->type;
+		int due = cell->due;
+		memcpy((char *)(em + 1), cell + 1, cell->size);
+		copiedBytes += cell->size;
+		recvMsgs++;
+		recvBytes += cell->size;
+
+		// free the cell for the sender that claims it one turn of the ring later
+		__atomic_store_n(&cell->seq, pos + inbox->slots, __ATOMIC_RELEASE);
+		pos++;
+
+		emulnet.currbuffsize++;
+		if ( due <= time ) {
+			emulnet.inbox[EM::key(myaddr, em->layer)].frames.push(em);
+		}
+		else {
+			en_hop hop;
+			hop.em = em;
+			hop.to = *myaddr;
+			hop.due = due;
+			wheel[due % EN_WHEEL_SIZE].push_back(hop);
+		}
+	}
+	inbox->dequeuePos = pos;
+
+	return EmulNet::ENrecv(myaddr, enq, t, times, queue, channel);
+}
+
+/**
+ * FUNCTION NAME: ENtick
+ *
+ * DESCRIPTION: Move the messages that came due into the inbox. Unlike EmulNet a
+ * 				node process may skip ticks, so every bucket since the last call is
+ * 				looked at.
+ *
+ * RETURNS:
+ * number of messages that arrived
+ */
+int ShmNet::ENtick() {
+	int time = par->getcurrtime();
+	int first = max(tickedUpTo + 1, time - EN_WHEEL_SIZE + 1);
+	int arrived = 0;
+
+	for ( int tick = first; tick <= time; tick++ ) {
+		vector<en_hop> &bucket = wheel[tick % EN_WHEEL_SIZE];
+		unsigned int kept = 0;
+		for ( unsigned int i = 0; i < bucket.size(); i++ ) {
+			en_hop &hop = bucket[i];
+			if ( hop.due > time ) {
+				bucket[kept++] = hop;
+				continue;
+			}
+			emulnet.inbox[EM::key(&hop.to, hop.em->layer)].frames.push(hop.em);
+			arrived++;
+		}
+		bucket.resize(kept);
+	}
+	tickedUpTo = time;
+
+	return arrived;
+}
+
+/**
+ * FUNCTION NAME: ENcleanup
+ *
+ * DESCRIPTION: Append the ring counters to netstats.log, remove the inbox segment
+ * 				and write msgcount.log like EmulNet does
+ */
+int ShmNet::ENcleanup() {
+	if ( NULL != inbox ) {
+		FILE *file = fopen(SHM_STATS_LOG, "a");
+		fprintf(file, "node %d ring %s: sent %ld messages %ld bytes  ring full %ld  no peer ring %ld\n", nodeId, segmentName(nodeId).c_str(), sentMsgs, sentBytes, ringFull, noPeer);
+		fprintf(file, "node %d ring %s: received %ld messages %ld bytes\n", nodeId, segmentName(nodeId).c_str(), recvMsgs, recvBytes);
+		fclose(file);
+
+		munmap(inbox, inboxBytes);
+		shm_unlink(segmentName(nodeId).c_str());
+		inbox = NULL;
+	}
+	return EmulNet::ENcleanup();
+}
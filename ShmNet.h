@@ -0,0 +1,110 @@
+/**********************************
+ * FILE NAME: ShmNet.h
+ *
+ * DESCRIPTION: EmulNet transport over shared memory rings
+ **********************************/
+
+#ifndef SHMNET_H_
+#define SHMNET_H_
+
+#include "stdincludes.h"
+#include "EmulNet.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * Macros
+ */
+// cells in every inbox ring, a power of two
+#define SHM_RING_SLOTS 512
+// written last by the owner, a sender only uses a ring that carries it
+#define SHM_RING_MAGIC 0x53484d52
+#define SHM_CACHE_LINE 64
+// file the ring counters of every network are appended to
+#define SHM_STATS_LOG "netstats.log"
+
+/**
+ * STRUCT NAME: shm_ring
+ *
+ * DESCRIPTION: Header of an inbox segment, followed by slots cells of stride bytes.
+ * 				The two positions sit on their own cache lines since senders only
+ * 				move the first and the owner only moves the second.
+ */
+typedef struct shm_ring {
+	unsigned int magic;
+	unsigned int slots;
+	unsigned int stride;
+	char pad0[SHM_CACHE_LINE - 3 * sizeof(unsigned int)];
+	unsigned long long enqueuePos;
+	char pad1[SHM_CACHE_LINE - sizeof(unsigned long long)];
+	unsigned long long dequeuePos;
+	char pad2[SHM_CACHE_LINE - sizeof(unsigned long long)];
+}shm_ring;
+
+/**
+ * STRUCT NAME: shm_cell
+ *
+ * DESCRIPTION: One message in a ring. seq tells whose turn the cell is: equal to
+ * 				a position it is free for the sender claiming that position, one
+ * 				more than it once that sender has filled it in.
+ */
+typedef struct shm_cell {
+	unsigned long long seq;
+	int size;
+	int from;
+	// first tick whose ENrecv may see the message, stamped by the sender
+	int due;
+	// traffic accounting tags of the frame
+	int layer;
+	int type;
+}shm_cell;
+
+/**
+ * CLASS NAME: ShmNet
+ *
+ * DESCRIPTION: One node's end of a network whose nodes live in separate processes
+ * 				on the same host. Every node owns a bounded multi-producer,
+ * 				single-consumer ring in /dev/shm that all the other nodes send
+ * 				into, so a send is a claim, a memcpy and a release store. Drops
+ * 				and the link model of EmulNet are applied by the sender; messages
+ * 				that are due later wait on the receiver's timer wheel.
+ */
+class ShmNet : public EmulNet {
+private:
+	// simulated id of the node this process runs
+	int nodeId;
+	// tells the segments of different networks apart
+	int portBase;
+	shm_ring *inbox;
+	size_t inboxBytes;
+	// rings of the nodes this one has sent to, by node id
+	unordered_map<int, shm_ring *> peers;
+	unordered_map<int, size_t> peerBytes;
+	// last tick whose wheel bucket was looked at
+	int tickedUpTo;
+	// traffic counters
+	long sentMsgs;
+	long sentBytes;
+	long ringFull;
+	long noPeer;
+	long recvMsgs;
+	long recvBytes;
+	string segmentName(int id);
+	shm_ring *mapRing(int id, bool create, size_t *bytes);
+	shm_ring *peerRing(int id);
+	static shm_cell *cellAt(shm_ring *ring, unsigned long long pos);
+	int sendTo(en_msg *em, Address *toaddr);
+public:
+	ShmNet(Params *p, int nodeId, int portBase);
+	virtual ~ShmNet();
+	void *ENinit(Address *myaddr, short port);
+	int ENsendFrame(Address *myaddr, Address *toaddr, char *data, int size);
+	int ENsendMulti(Address *myaddr, vector<Address> &toList, char *data, int size);
+	int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue, int channel);
+	int ENtick();
+	int ENcleanup();
+};
+
+#endif /* SHMNET_H_ */
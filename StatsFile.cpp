@@ -0,0 +1,120 @@
+/**********************************
+ * FILE NAME: StatsFile.cpp
+ *
+ * DESCRIPTION: Definition of the StatsFile class
+ **********************************/
+
+#include "StatsFile.h"
+
+/**
+ * FUNCTION NAME: putInt
+ *
+ * DESCRIPTION: Store value little endian at buf
+ */
+void StatsFile::putInt(char *buf, int value) {
+	unsigned int v = (unsigned int)value;
+	for ( int i = 0; i < 4; i++ ) {
+		buf[i] = (char)((v >> (8 * i)) & 0xff);
+	}
+}
+
+/**
+ * FUNCTION NAME: getInt
+ *
+ * DESCRIPTION: Little endian integer at buf
+ */
+int StatsFile::getInt(const char *buf) {
+	unsigned int v = 0;
+	for ( int i = 0; i < 4; i++ ) {
+		v |= (unsigned int)(unsigned char)buf[i] << (8 * i);
+	}
+	return (int)v;
+}
+
+/**
+ * FUNCTION NAME: writeHeader
+ *
+ * DESCRIPTION: Start the section of a network
+ */
+void StatsFile::writeHeader(FILE *file, st_header *hdr) {
+	char buf[sizeof(hdr->magic) + 5 * 4];
+	memset(buf, 0, sizeof(buf));
+	memcpy(buf, STATS_MAGIC, strlen(STATS_MAGIC));
+	putInt(buf + 8, hdr->version);
+	putInt(buf + 12, hdr->network);
+	putInt(buf + 16, hdr->nodes);
+	putInt(buf + 20, hdr->ticks);
+	putInt(buf + 24, hdr->columns);
+	fwrite(buf, 1, sizeof(buf), file);
+}
+
+/**
+ * FUNCTION NAME: writeColumn
+ *
+ * DESCRIPTION: Write the counters of nodes 1 to nodes over ticks 0 to ticks - 1.
+ * 				Counters never touched are written as 0.
+ */
+void StatsFile::writeColumn(FILE *file, const char *name, const vector<vector<int> > &counters, int nodes, int ticks) {
+	vector<char> buf(STATS_NAME_SIZE + (size_t)nodes * ticks * 4, 0);
+	strncpy(buf.data(), name, STATS_NAME_SIZE - 1);
+
+	char *pos = buf.data() + STATS_NAME_SIZE;
+	for ( int node = 1; node <= nodes; node++ ) {
+		if ( node < (int)counters.size() ) {
+			const vector<int> &row = counters[node];
+			int filled = min((int)row.size(), ticks);
+			for ( int t = 0; t < filled; t++ ) {
+				putInt(pos + 4 * t, row[t]);
+			}
+		}
+		pos += (size_t)ticks * 4;
+	}
+	fwrite(buf.data(), 1, buf.size(), file);
+}
+
+/**
+ * FUNCTION NAME: readHeader
+ *
+ * DESCRIPTION: Read the header of the next section
+ *
+ * RETURNS:
+ * false at the end of the file or on a file that is not a stats file
+ */
+bool StatsFile::readHeader(FILE *file, st_header *hdr) {
+	char buf[sizeof(hdr->magic) + 5 * 4];
+	if ( fread(buf, 1, sizeof(buf), file) != sizeof(buf) ) {
+		return false;
+	}
+	if ( 0 != memcmp(buf, STATS_MAGIC, strlen(STATS_MAGIC)) ) {
+		return false;
+	}
+	memcpy(hdr->magic, buf, sizeof(hdr->magic));
+	hdr->version = getInt(buf + 8);
+	hdr->network = getInt(buf + 12);
+	hdr->nodes = getInt(buf + 16);
+	hdr->ticks = getInt(buf + 20);
+	hdr->columns = getInt(buf + 24);
+	return STATS_VERSION == hdr->version && hdr->nodes >= 0 && hdr->ticks >= 0 && hdr->columns >= 0;
+}
+
+/**
+ * FUNCTION NAME: readColumn
+ *
+ * DESCRIPTION: Read the next column of the section, values[(node - 1) * ticks + tick]
+ *
+ * RETURNS:
+ * false if the file ends early
+ */
+bool StatsFile::readColumn(FILE *file, st_header *hdr, string &name, vector<int> &values) {
+	size_t cells = (size_t)hdr->nodes * hdr->ticks;
+	vector<char> buf(STATS_NAME_SIZE + cells * 4);
+	if ( fread(buf.data(), 1, buf.size(), file) != buf.size() ) {
+		return false;
+	}
+	name.assign(buf.data(), strnlen(buf.data(), STATS_NAME_SIZE));
+	values.resize(cells);
+	for ( size_t i = 0; i < cells; i++ ) {
+		values[i] = getInt(buf.data() + STATS_NAME_SIZE + 4 * i);
+	}
+	return true;
+}
@@ -0,0 +1,55 @@
+/**********************************
+ * FILE NAME: StatsFile.h
+ *
+ * DESCRIPTION: Binary per node, per tick counter file written by EmulNet
+ **********************************/
+
+#ifndef STATSFILE_H_
+#define STATSFILE_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+#define STATS_FILE "msgcount.bin"
+#define STATS_MAGIC "ENSTATS"
+#define STATS_VERSION 1
+// bytes of a column name, NUL padded
+#define STATS_NAME_SIZE 32
+
+/**
+ * STRUCT NAME: st_header
+ *
+ * DESCRIPTION: Header of the section of one network. The file is one section per
+ * 				network, each followed by columns columns: a name, then nodes rows
+ * 				of ticks 32-bit counters, node 1 first. Every integer is stored
+ * 				little endian whatever the host.
+ */
+typedef struct st_header {
+	char magic[8];
+	int version;
+	int network;
+	int nodes;
+	int ticks;
+	int columns;
+}st_header;
+
+/**
+ * CLASS NAME: StatsFile
+ *
+ * DESCRIPTION: Writes and reads the sections of STATS_FILE. A column is built in
+ * 				memory and written with a single fwrite.
+ */
+class StatsFile {
+private:
+	static void putInt(char *buf, int value);
+	static int getInt(const char *buf);
+public:
+	static void writeHeader(FILE *file, st_header *hdr);
+	static void writeColumn(FILE *file, const char *name, const vector<vector<int> > &counters, int nodes, int ticks);
+	static bool readHeader(FILE *file, st_header *hdr);
+	static bool readColumn(FILE *file, st_header *hdr, string &name, vector<int> &values);
+};
+
+#endif /* STATSFILE_H_ */
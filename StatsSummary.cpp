@@ -0,0 +1,87 @@
+/**********************************
+ * FILE NAME: StatsSummary.cpp
+ *
+ * DESCRIPTION: Prints totals and percentiles of the counters in a stats file
+ **********************************/
+
+#include "StatsFile.h"
+
+/**
+ * FUNCTION NAME: percentile
+ *
+ * DESCRIPTION: Nearest rank percentile p of sorted
+ */
+static long percentile(const vector<long> &sorted, double p) {
+	if ( sorted.empty() ) {
+		return 0;
+	}
+	size_t rank = (size_t)ceil(p / 100.0 * sorted.size());
+	return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+/**
+ * FUNCTION NAME: summarize
+ *
+ * DESCRIPTION: One line per column. The tick figures are over the sums of all
+ * 				nodes in a tick, the node figures over the totals of each node.
+ */
+static void summarize(const string &name, const vector<int> &values, st_header *hdr) {
+	vector<long> perTick(hdr->ticks, 0);
+	vector<long> perNode(hdr->nodes, 0);
+	long total = 0;
+
+	for ( int node = 0; node < hdr->nodes; node++ ) {
+		for ( int t = 0; t < hdr->ticks; t++ ) {
+			int value = values[(size_t)node * hdr->ticks + t];
+			perTick[t] += value;
+			perNode[node] += value;
+			total += value;
+		}
+	}
+	sort(perTick.begin(), perTick.end());
+	sort(perNode.begin(), perNode.end());
+
+	printf("%-28s %12ld %10ld %10ld %10ld %10ld %10ld %10ld\n", name.c_str(), total,
+			percentile(perTick, 50), percentile(perTick, 90), percentile(perTick, 99), perTick.empty() ? 0 : perTick.back(),
+			perNode.empty() ? 0 : perNode.front(), perNode.empty() ? 0 : perNode.back());
+}
+
+/**********************************
+ * FUNCTION NAME: main
+ *
+ * DESCRIPTION: main function of the summarizer, reads msgcount.bin or the file given
+ **********************************/
+int main(int argc, char *argv[]) {
+	const char *path = argc > 1 ? argv[1] : STATS_FILE;
+	FILE *file = fopen(path, "rb");
+	if ( NULL == file ) {
+		perror(path);
+		return FAILURE;
+	}
+
+	st_header hdr;
+	int sections = 0;
+	while ( StatsFile::readHeader(file, &hdr) ) {
+		printf("network %d: %d nodes, %d ticks\n", hdr.network, hdr.nodes, hdr.ticks);
+		printf("%-28s %12s %10s %10s %10s %10s %10s %10s\n", "column", "total", "tick p50", "tick p90", "tick p99", "tick max", "node min", "node max");
+		for ( int c = 0; c < hdr.columns; c++ ) {
+			string name;
+			vector<int> values;
+			if ( !StatsFile::readColumn(file, &hdr, name, values) ) {
+				fprintf(stderr, "%s: truncated in network %d\n", path, hdr.network);
+				fclose(file);
+				return FAILURE;
+			}
+			summarize(name, values, &hdr);
+		}
+		printf("\n");
+		sections++;
+	}
+	fclose(file);
+
+	if ( 0 == sections ) {
+		fprintf(stderr, "%s: not a stats file\n", path);
+		return FAILURE;
+	}
+	return SUCCESS;
+}
@@ -0,0 +1,283 @@
+/**********************************
+ * FILE NAME: UdpApplication.cpp
+ *
+ * DESCRIPTION: UdpApplication class function definitions
+ **********************************/
+
+#include "UdpApplication.h"
+
+/**********************************
+ * FUNCTION NAME: main
+ *
+ * DESCRIPTION: main function of the multi process run
+ **********************************/
+int main(int argc, char *argv[]) {
+	if ( argc != ARGS_COUNT ) {
+		cout<<"Configuration (i.e., *.conf) file File Required"<<endl;
+		return FAILURE;
+	}
+
+	UdpApplication *app = new UdpApplication(argv[1]);
+	int result = app->run();
+	delete(app);
+
+	return result;
+}
+
+/**
+ * Constructor
+ */
+UdpApplication::UdpApplication(char *infile) {
+	par = new Params();
+	par->setparams(infile);
+	initTestKVPairs();
+}
+
+/**
+ * Destructor
+ */
+UdpApplication::~UdpApplication() {
+	delete par;
+}
+
+/**
+ * FUNCTION NAME: run
+ *
+ * DESCRIPTION: Fork one process per node and wait for all of them
+ */
+int UdpApplication::run() {
+	int failed = 0;
+	vector<pid_t> children;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	long startNsec = start.tv_nsec + (long)UDP_START_DELAY_USEC * 1000;
+	start.tv_sec += startNsec / 1000000000L;
+	start.tv_nsec = startNsec % 1000000000L;
+
+	cout<<"Random seed: "<<par->SEED<<endl;
+	cout<<"Starting "<<par->EN_GPSZ<<" node processes, "<<par->TICK_USEC<<" usec per tick"<<endl;
+	fflush(stdout);
+
+	for ( int i = 0; i < par->EN_GPSZ; i++ ) {
+		pid_t pid = fork();
+		if ( pid < 0 ) {
+			perror("fork");
+			failed++;
+			break;
+		}
+		if ( 0 == pid ) {
+			_exit(runNode(i));
+		}
+		children.push_back(pid);
+	}
+
+	for ( unsigned int i = 0; i < children.size(); i++ ) {
+		int status;
+		waitpid(children[i], &status, 0);
+		if ( !WIFEXITED(status) || WEXITSTATUS(status) != SUCCESS ) {
+			failed++;
+		}
+	}
+
+	cout<<children.size() - failed<<" node processes finished, "<<failed<<" failed"<<endl;
+	return failed ? FAILURE : SUCCESS;
+}
+
+/**
+ * FUNCTION NAME: openTimer
+ *
+ * DESCRIPTION: timerfd that expires at tick 0 and then every TICK_USEC
+ */
+int UdpApplication::openTimer() {
+	int fd = timerfd_create(CLOCK_MONOTONIC, 0);
+	if ( fd < 0 ) {
+		return -1;
+	}
+	struct itimerspec period;
+	period.it_value = start;
+	period.it_interval.tv_sec = par->TICK_USEC / 1000000;
+	period.it_interval.tv_nsec = (long)(par->TICK_USEC % 1000000) * 1000;
+	if ( timerfd_settime(fd, TFD_TIMER_ABSTIME, &period, NULL) < 0 ) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/**
+ * FUNCTION NAME: newNet
+ *
+ * DESCRIPTION: This node's end of the network picked by TRANSPORT
+ */
+EmulNet *UdpApplication::newNet(int id, int portBase) {
+	if ( SHM_TRANSPORT == par->TRANSPORT ) {
+		return new ShmNet(par, id, portBase);
+	}
+	return new UdpNet(par, id, portBase);
+}
+
+/**
+ * FUNCTION NAME: runNode
+ *
+ * DESCRIPTION: Body of a node process. Runs the same per-node steps as
+ * 				Application::mp1Run and Application::mp2Run, one tick per timer
+ * 				expiry. When the process falls behind, the missed ticks are skipped
+ * 				so that every process stays on the shared clock.
+ *
+ * RETURNS:
+ * exit status of the process
+ */
+int UdpApplication::runNode(int index) {
+	int id = index + 1;
+	char dir[32];
+	sprintf(dir, "node_%d", id);
+	mkdir(dir, 0755);
+	if ( chdir(dir) < 0 ) {
+		perror("chdir");
+		return FAILURE;
+	}
+	freopen("stdout.log", "w", stdout);
+
+	// every process hands out its own range of generator streams
+	par->rngStreams = id * UDP_NODE_STREAMS;
+
+	Log *log = new Log(par);
+	EmulNet *en = newNet(id, par->UDP_BASE_PORT);
+	EmulNet *en1 = newNet(id, par->UDP_BASE_PORT + par->EN_GPSZ + 1);
+	Member *memberNode = new Member;
+	memberNode->inited = false;
+	Address addressOfMemberNode;
+	en->ENinit(&addressOfMemberNode, par->PORTNUM);
+	en1->ENinit(&addressOfMemberNode, par->PORTNUM);
+	MP1Node *mp1 = new MP1Node(memberNode, par, en, log, &addressOfMemberNode);
+	MP2Node *mp2 = new MP2Node(memberNode, par, en1, log, &addressOfMemberNode);
+	log->LOG(&memberNode->addr, "APP");
+	log->LOG(&memberNode->addr, "APP MP2");
+
+	int timer = openTimer();
+	if ( timer < 0 ) {
+		perror("timerfd");
+		return FAILURE;
+	}
+
+	// KV store starts once the last node had 50 ticks to join, as in Application::run
+	int joinTime = (int)(par->STEP_RATE * index);
+	int kvStartTime = (int)(par->STEP_RATE * (par->EN_GPSZ - 1)) + 50;
+	long ticksRun = 0;
+	long ticksSkipped = 0;
+	long tick = -1;
+	char JOINADDR[30] = "";
+
+	while ( tick + 1 < TOTAL_RUNNING_TIME ) {
+		unsigned long long expirations;
+		if ( read(timer, &expirations, sizeof(expirations)) != sizeof(expirations) ) {
+			continue;
+		}
+		tick += expirations;
+		ticksSkipped += expirations - 1;
+		if ( tick >= TOTAL_RUNNING_TIME ) {
+			break;
+		}
+		par->globaltime = tick;
+		ticksRun++;
+		en->ENtick();
+		en1->ENtick();
+
+		// membership protocol
+		if ( par->getcurrtime() > joinTime && !memberNode->bFailed ) {
+			mp1->recvLoop();
+		}
+		if ( memberNode->inited == false && par->getcurrtime() >= joinTime ) {
+			mp1->nodeStart(JOINADDR, par->PORTNUM);
+			cout<<index<<"-th introduced node is assigned with the address: "<<memberNode->addr.getAddress()<<endl;
+		}
+		else if ( par->getcurrtime() > joinTime && !memberNode->bFailed ) {
+			mp1->nodeLoop();
+		}
+		en->ENflush();
+
+		// key value store
+		if ( par->getcurrtime() > kvStartTime && !memberNode->bFailed ) {
+			if ( memberNode->inited && memberNode->inGroup ) {
+				mp2->updateRing();
+			}
+			mp2->recvLoop();
+			mp2->checkMessages();
+			clientOps(mp2, log, index);
+		}
+		en1->ENflush();
+	}
+
+	cout<<"ticks run "<<ticksRun<<"  ticks skipped "<<ticksSkipped<<endl;
+
+	close(timer);
+	en->ENcleanup();
+	en1->ENcleanup();
+	mp1->finishUpThisNode();
+
+	delete mp1;
+	delete mp2;
+	delete en;
+	delete en1;
+	delete log;
+	return SUCCESS;
+}
+
+/**
+ * FUNCTION NAME: initTestKVPairs
+ *
+ * DESCRIPTION: Same key value pairs as Application::initTestKVPairs makes, drawn
+ * 				from a generator every process seeds alike
+ */
+void UdpApplication::initTestKVPairs() {
+	Random rng(par->SEED, UDP_WORKLOAD_STREAM);
+	int i;
+	string key;
+	testKVPairs.clear();
+	int alphanumLen = sizeof(alphanum) - 1;
+	while ( testKVPairs.size() != NUMBER_OF_INSERTS ) {
+		for ( i = 0; i < KEY_LENGTH; i++ ) {
+			key.push_back(alphanum[rng.nextInt(alphanumLen)]);
+		}
+		string value = "value" + to_string(rng.nextInt(NUMBER_OF_INSERTS));
+		testKVPairs[key] = value;
+		key.clear();
+	}
+}
+
+/**
+ * FUNCTION NAME: clientOps
+ *
+ * DESCRIPTION: The test workload. Node index coordinates every EN_GPSZ-th key:
+ * 				creates at INSERT_TIME, then the operation of CRUD_TEST at TEST_TIME.
+ */
+void UdpApplication::clientOps(MP2Node *mp2, Log *log, int index) {
+	if ( par->getcurrtime() != INSERT_TIME && par->getcurrtime() != TEST_TIME ) {
+		return;
+	}
+
+	int k = 0;
+	for ( map<string, string>::iterator it = testKVPairs.begin(); it != testKVPairs.end(); ++it, ++k ) {
+		if ( k % par->EN_GPSZ != index ) {
+			continue;
+		}
+		Address *addr = &mp2->getMemberNode()->addr;
+		if ( par->getcurrtime() == INSERT_TIME ) {
+			log->LOG(addr, "CREATE OPERATION KEY: %s VALUE: %s at time: %d", it->first.c_str(), it->second.c_str(), par->getcurrtime());
+			mp2->clientCreate(it->first, it->second);
+		}
+		else if ( READ_TEST == par->CRUDTEST ) {
+			log->LOG(addr, "READ OPERATION KEY: %s VALUE: %s at time: %d", it->first.c_str(), it->second.c_str(), par->getcurrtime());
+			mp2->clientRead(it->first);
+		}
+		else if ( UPDATE_TEST == par->CRUDTEST ) {
+			string newValue = it->second + "_updated";
+			log->LOG(addr, "UPDATE OPERATION KEY: %s VALUE: %s at time: %d", it->first.c_str(), newValue.c_str(), par->getcurrtime());
+			mp2->clientUpdate(it->first, newValue);
+		}
+		else if ( DELETE_TEST == par->CRUDTEST ) {
+			log->LOG(addr, "DELETE OPERATION KEY: %s VALUE: %s at time: %d", it->first.c_str(), it->second.c_str(), par->getcurrtime());
+			mp2->clientDelete(it->first);
+		}
+	}
+}
@@ -0,0 +1,55 @@
+/**********************************
+ * FILE NAME: UdpApplication.h
+ *
+ * DESCRIPTION: Runs every node as its own process over loopback UDP or shared memory
+ **********************************/
+
+#ifndef _UDPAPPLICATION_H_
+#define _UDPAPPLICATION_H_
+
+#include "stdincludes.h"
+#include "Application.h"
+#include "UdpNet.h"
+#include "ShmNet.h"
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+
+/*
+ * Macros
+ */
+// time given to the node processes to start and bind before tick 0
+#define UDP_START_DELAY_USEC 200000
+// generators of node n are handed out from stream n * UDP_NODE_STREAMS
+#define UDP_NODE_STREAMS 16
+// stream of the generator every process uses to agree on the test keys
+#define UDP_WORKLOAD_STREAM 0
+
+/**
+ * CLASS NAME: UdpApplication
+ *
+ * DESCRIPTION: Launcher that forks one process per node. Each process runs one
+ * 				MP1Node and one MP2Node, in its own node_<id> directory,
+ * 				and advances a tick every TICK_USEC of wall clock time, measured
+ * 				by a timerfd started at the same instant in all processes. The
+ * 				network is UdpNet, or ShmNet with TRANSPORT: shm.
+ */
+class UdpApplication {
+private:
+	Params *par;
+	// wall clock time of tick 0
+	struct timespec start;
+	// the test keys, the same in every process
+	map<string, string> testKVPairs;
+	EmulNet *newNet(int id, int portBase);
+	int runNode(int index);
+	int openTimer();
+	void initTestKVPairs();
+	void clientOps(MP2Node *mp2, Log *log, int index);
+public:
+	UdpApplication(char *infile);
+	virtual ~UdpApplication();
+	int run();
+};
+
+#endif /* _UDPAPPLICATION_H_ */
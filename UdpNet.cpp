@@ -0,0 +1,323 @@
+/**********************************
+ * FILE NAME: UdpNet.cpp
+ *
+ * DESCRIPTION: Definition of the UdpNet class
+ **********************************/
+
+#include "UdpNet.h"
+
+/**
+ * Constructor
+ */
+UdpNet::UdpNet(Params *p, int nodeId, int portBase): EmulNet(p) {
+	this->nodeId = nodeId;
+	this->portBase = portBase;
+	sock = -1;
+	sendCalls = 0;
+	sentDatagrams = 0;
+	sentBytes = 0;
+	sendErrors = 0;
+	recvCalls = 0;
+	recvDatagrams = 0;
+	recvBytes = 0;
+	for ( int i = 0; i < UDP_BATCH; i++ ) {
+		recvFrames[i] = NULL;
+	}
+}
+
+/**
+ * Destructor
+ */
+UdpNet::~UdpNet() {
+	if ( sock >= 0 ) {
+		close(sock);
+	}
+	for ( unsigned int i = 0; i < pending.size(); i++ ) {
+		FramePool::release(pending[i].em);
+	}
+	for ( int i = 0; i < UDP_BATCH; i++ ) {
+		FramePool::release(recvFrames[i]);
+	}
+}
+
+/**
+ * FUNCTION NAME: ENinit
+ *
+ * DESCRIPTION: Give this process its node id and bind its socket
+ */
+void *UdpNet::ENinit(Address *myaddr, short port) {
+	*(int *)(myaddr->addr) = nodeId;
+	*(short *)(&myaddr->addr[4]) = 0;
+
+	sock = socket(AF_INET, SOCK_DGRAM, 0);
+	if ( sock < 0 ) {
+		perror("UdpNet socket");
+		exit(1);
+	}
+	int rcvbuf = UDP_RCVBUF;
+	setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+	struct sockaddr_in sa;
+	toSockaddr(myaddr, &sa);
+	if ( bind(sock, (struct sockaddr *)&sa, sizeof(sa)) < 0 ) {
+		perror("UdpNet bind");
+		exit(1);
+	}
+
+	for ( int i = 0; i < UDP_BATCH; i++ ) {
+		recvFrames[i] = newRecvFrame();
+	}
+	return myaddr;
+}
+
+/**
+ * FUNCTION NAME: newRecvFrame
+ *
+ * DESCRIPTION: Frame large enough for any datagram a node may send
+ */
+en_msg *UdpNet::newRecvFrame() {
+	return (en_msg *)pool.alloc(sizeof(en_msg) + par->MAX_MSG_SIZE);
+}
+
+/**
+ * FUNCTION NAME: toSockaddr
+ *
+ * DESCRIPTION: Loopback socket address of a simulated node address
+ */
+void UdpNet::toSockaddr(Address *addr, struct sockaddr_in *sa) {
+	memset(sa, 0, sizeof(*sa));
+	sa->sin_family = AF_INET;
+	sa->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sa->sin_port = htons(portBase + *(int *)(addr->addr));
+}
+
+/**
+ * FUNCTION NAME: ENsendFrame
+ *
+ * DESCRIPTION: Send a frame obtained from ENgetFrame to one node
+ *
+ * RETURNS:
+ * size, 0 if the message was dropped
+ */
+int UdpNet::ENsendFrame(Address *myaddr, Address *toaddr, char *data, int size) {
+	en_msg *em = (en_msg *)ENframeOf(data);
+
+	em->size = size;
+	memcpy(&(em->from.addr), &(myaddr->addr), sizeof(em->from.addr));
+	return queueFrame(em, toaddr);
+}
+
+/**
+ * FUNCTION NAME: ENsendMulti
+ *
+ * DESCRIPTION: Queue one frame for every node of toList. The datagrams of a
+ * 				batch all point at the same payload.
+ *
+ * RETURNS:
+ * number of destinations the frame was queued for
+ */
+int UdpNet::ENsendMulti(Address *myaddr, vector<Address> &toList, char *data, int size) {
+	en_msg *em = (en_msg *)ENframeOf(data);
+	int sent = 0;
+
+	if ( toList.empty() ) {
+		FramePool::release(em);
+		return 0;
+	}
+
+	em->size = size;
+	memcpy(&(em->from.addr), &(myaddr->addr), sizeof(em->from.addr));
+	for ( unsigned int i = 1; i < toList.size(); i++ ) {
+		FramePool::retain(em);
+	}
+	for ( unsigned int i = 0; i < toList.size(); i++ ) {
+		if ( queueFrame(em, &toList[i]) > 0 ) {
+			sent++;
+		}
+	}
+	return sent;
+}
+
+/**
+ * FUNCTION NAME: queueFrame
+ *
+ * DESCRIPTION: Queue one reference to the frame for the next batch. A full batch
+ * 				goes out at once.
+ *
+ * RETURNS:
+ * size, 0 if the message was dropped
+ */
+int UdpNet::queueFrame(en_msg *em, Address *toaddr) {
+	int size = em->size;
+
+	if( (size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE) || (par->dropmsg && rng.nextInt(100) < (int) (par->MSG_DROP_PROB * 100)) ) {
+		FramePool::release(em);
+		return 0;
+	}
+
+	en_hop hop;
+	hop.em = em;
+	hop.to = *toaddr;
+	pending.push_back(hop);
+	countMsg(sent_msgs, nodeId, par->getcurrtime(), 1);
+	countTraffic(true, nodeId, par->getcurrtime(), em->layer, em->type, size);
+
+	if ( pending.size() >= UDP_BATCH ) {
+		sendPending();
+	}
+	return size;
+}
+
+/**
+ * FUNCTION NAME: sendPending
+ *
+ * DESCRIPTION: Send the queued frames with as few sendmmsg calls as possible
+ *
+ * RETURNS:
+ * number of datagrams sent
+ */
+int UdpNet::sendPending() {
+	struct mmsghdr msgs[UDP_BATCH];
+	struct iovec iov[UDP_BATCH];
+	struct sockaddr_in to[UDP_BATCH];
+	unsigned int done = 0;
+	int sent = 0;
+
+	while ( done < pending.size() ) {
+		int count = min((int)(pending.size() - done), UDP_BATCH);
+		memset(msgs, 0, sizeof(struct mmsghdr) * count);
+		for ( int i = 0; i < count; i++ ) {
+			en_msg *em = pending[done + i].em;
+			toSockaddr(&pending[done + i].to, &to[i]);
+			iov[i].iov_base = em + 1;
+			iov[i].iov_len = em->size;
+			msgs[i].msg_hdr.msg_name = &to[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(to[i]);
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		int result = sendmmsg(sock, msgs, count, 0);
+		sendCalls++;
+		if ( result < 0 ) {
+			if ( EINTR == errno ) {
+				continue;
+			}
+			// the datagram at the head failed, skip it and go on with the rest
+			sendErrors++;
+			result = 1;
+		}
+		else {
+			for ( int i = 0; i < result; i++ ) {
+				sentBytes += msgs[i].msg_len;
+			}
+			sentDatagrams += result;
+			sent += result;
+		}
+		done += result;
+	}
+
+	for ( unsigned int i = 0; i < pending.size(); i++ ) {
+		FramePool::release(pending[i].em);
+	}
+	pending.clear();
+	return sent;
+}
+
+/**
+ * FUNCTION NAME: ENrecv
+ *
+ * DESCRIPTION: Hand every datagram waiting on the socket to the node queue. Each
+ * 				network has a socket of its own, so channel is not looked at.
+ *
+ * RETURN:
+ * 0
+ */
+int UdpNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue, int channel) {
+	struct mmsghdr msgs[UDP_BATCH];
+	struct iovec iov[UDP_BATCH];
+	struct sockaddr_in from[UDP_BATCH];
+	int received = 0;
+
+	while ( true ) {
+		memset(msgs, 0, sizeof(msgs));
+		for ( int i = 0; i < UDP_BATCH; i++ ) {
+			iov[i].iov_base = recvFrames[i] + 1;
+			iov[i].iov_len = par->MAX_MSG_SIZE;
+			msgs[i].msg_hdr.msg_name = &from[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		int count = recvmmsg(sock, msgs, UDP_BATCH, MSG_DONTWAIT, NULL);
+		recvCalls++;
+		if ( count <= 0 ) {
+			break;
+		}
+
+		for ( int i = 0; i < count; i++ ) {
+			en_msg *em = recvFrames[i];
+			em->size = msgs[i].msg_len;
+			// the sender is known by the port it is bound to
+			int fromId = ntohs(from[i].sin_port) - portBase;
+			memset(em->from.addr, 0, sizeof(em->from.addr));
+			memcpy(&em->from.addr[0], &fromId, sizeof(int));
+			em->batch = 0;
+			em->frag = 0;
+			em->raw = 0;
+			// datagrams do not carry the tags, they are counted as untagged
+			em->layer = EN_LAYER_NONE;
+			em->type = 0;
+			countTraffic(false, nodeId, par->getcurrtime(), EN_LAYER_NONE, 0, em->size);
+			recvBytes += em->size;
+
+			(*enq)(queue, (char *)(em + 1), em->size);
+			recvFrames[i] = newRecvFrame();
+		}
+		received += count;
+		recvDatagrams += count;
+
+		if ( count < UDP_BATCH ) {
+			break;
+		}
+	}
+
+	if ( received > 0 ) {
+		deliveredMsgs += received;
+		countMsg(recv_msgs, nodeId, par->getcurrtime(), received);
+	}
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: ENflush
+ *
+ * DESCRIPTION: Send what is still queued, called once per tick
+ *
+ * RETURNS:
+ * number of datagrams sent
+ */
+int UdpNet::ENflush() {
+	return sendPending();
+}
+
+/**
+ * FUNCTION NAME: ENcleanup
+ *
+ * DESCRIPTION: Close the socket, append the socket counters to netstats.log and
+ * 				write msgcount.log like EmulNet does
+ */
+int UdpNet::ENcleanup() {
+	if ( sock >= 0 ) {
+		sendPending();
+		close(sock);
+		sock = -1;
+
+		FILE *file = fopen(UDP_STATS_LOG, "a");
+		fprintf(file, "node %d port %d: sendmmsg %ld  sent %ld datagrams %ld bytes  send errors %ld\n", nodeId, portBase + nodeId, sendCalls, sentDatagrams, sentBytes, sendErrors);
+		fprintf(file, "node %d port %d: recvmmsg %ld  received %ld datagrams %ld bytes\n", nodeId, portBase + nodeId, recvCalls, recvDatagrams, recvBytes);
+		fclose(file);
+	}
+	return EmulNet::ENcleanup();
+}
@@ -0,0 +1,69 @@
+/**********************************
+ * FILE NAME: UdpNet.h
+ *
+ * DESCRIPTION: EmulNet transport over UDP on the loopback interface
+ **********************************/
+
+#ifndef UDPNET_H_
+#define UDPNET_H_
+
+#include "stdincludes.h"
+#include "EmulNet.h"
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/*
+ * Macros
+ */
+// datagrams moved per sendmmsg/recvmmsg call
+#define UDP_BATCH 64
+// receive buffer asked for on every socket
+#define UDP_RCVBUF (4 * 1024 * 1024)
+// file the socket counters of every network are appended to
+#define UDP_STATS_LOG "netstats.log"
+
+/**
+ * CLASS NAME: UdpNet
+ *
+ * DESCRIPTION: One node's end of a network whose nodes live in separate processes.
+ * 				Node id n listens on 127.0.0.1 port portBase + n. Sends are queued
+ * 				and leave in batches through sendmmsg when the batch is full or on
+ * 				ENflush; ENrecv drains the socket with recvmmsg straight into pooled
+ * 				frames, which the node queue releases as it does for EmulNet.
+ */
+class UdpNet : public EmulNet {
+private:
+	// simulated id of the node this process runs
+	int nodeId;
+	int portBase;
+	int sock;
+	// frames waiting for the next sendmmsg, in send order
+	vector<en_hop> pending;
+	// frames recvmmsg receives into, replaced as they are handed to the node
+	en_msg *recvFrames[UDP_BATCH];
+	// syscall and traffic counters
+	long sendCalls;
+	long sentDatagrams;
+	long sentBytes;
+	long sendErrors;
+	long recvCalls;
+	long recvDatagrams;
+	long recvBytes;
+	en_msg *newRecvFrame();
+	void toSockaddr(Address *addr, struct sockaddr_in *sa);
+	int queueFrame(en_msg *em, Address *toaddr);
+	int sendPending();
+public:
+	UdpNet(Params *p, int nodeId, int portBase);
+	virtual ~UdpNet();
+	void *ENinit(Address *myaddr, short port);
+	int ENsendFrame(Address *myaddr, Address *toaddr, char *data, int size);
+	int ENsendMulti(Address *myaddr, vector<Address> &toList, char *data, int size);
+	int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue, int channel);
+	int ENflush();
+	int ENcleanup();
+};
+
+#endif /* UDPNET_H_ */
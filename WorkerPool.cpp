@@ -0,0 +1,135 @@
+/**********************************
+ * FILE NAME: WorkerPool.cpp
+ *
+ * DESCRIPTION: Definition of the WorkerPool class
+ **********************************/
+
+#include "WorkerPool.h"
+
+thread_local int WorkerPool::slot = -1;
+
+/**
+ * Constructor
+ *
+ * numThreads threads run a phase, the calling thread being one of them.
+ * 0 picks one thread per core.
+ */
+WorkerPool::WorkerPool(int numThreads): count(0), generation(0), busy(0), stopping(false) {
+	if ( numThreads <= 0 ) {
+		numThreads = thread::hardware_concurrency();
+	}
+	if ( numThreads <= 0 ) {
+		numThreads = 1;
+	}
+	for ( int i = 1; i < numThreads; i++ ) {
+		workers.push_back(thread(&WorkerPool::workerLoop, this, i));
+	}
+}
+
+/**
+ * Destructor
+ */
+WorkerPool::~WorkerPool() {
+	{
+		unique_lock<mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for ( unsigned int i = 0; i < workers.size(); i++ ) {
+		workers[i].join();
+	}
+}
+
+/**
+ * FUNCTION NAME: size
+ *
+ * DESCRIPTION: Number of slots a phase is split into
+ */
+int WorkerPool::size() {
+	return workers.size() + 1;
+}
+
+/**
+ * FUNCTION NAME: currentSlot
+ *
+ * DESCRIPTION: Slot of the calling thread, -1 when it is not running a phase
+ */
+int WorkerPool::currentSlot() {
+	return slot;
+}
+
+/**
+ * FUNCTION NAME: run
+ *
+ * DESCRIPTION: Call body(k) for k = 0 .. count-1. Slot s gets the s-th contiguous
+ * 				range of k, so concatenating the slots in order gives the serial
+ * 				order. Returns when all slots are done.
+ */
+void WorkerPool::run(int count, function<void(int)> body) {
+	if ( workers.empty() ) {
+		this->count = count;
+		this->body = body;
+		runSlot(0);
+		return;
+	}
+
+	{
+		unique_lock<mutex> guard(lock);
+		this->count = count;
+		this->body = body;
+		busy = workers.size();
+		generation++;
+	}
+	wake.notify_all();
+
+	runSlot(0);
+
+	unique_lock<mutex> guard(lock);
+	while ( busy > 0 ) {
+		done.wait(guard);
+	}
+}
+
+/**
+ * FUNCTION NAME: runSlot
+ *
+ * DESCRIPTION: Run the range of the current phase that belongs to workerSlot
+ */
+void WorkerPool::runSlot(int workerSlot) {
+	int slots = size();
+	int begin = (long)count * workerSlot / slots;
+	int end = (long)count * (workerSlot + 1) / slots;
+
+	slot = workerSlot;
+	for ( int k = begin; k < end; k++ ) {
+		body(k);
+	}
+	slot = -1;
+}
+
+/**
+ * FUNCTION NAME: workerLoop
+ *
+ * DESCRIPTION: Body of a worker thread, runs its slot once per phase
+ */
+void WorkerPool::workerLoop(int workerSlot) {
+	long seen = 0;
+	unique_lock<mutex> guard(lock);
+	while ( true ) {
+		while ( !stopping && generation == seen ) {
+			wake.wait(guard);
+		}
+		if ( stopping ) {
+			return;
+		}
+		seen = generation;
+
+		guard.unlock();
+		runSlot(workerSlot);
+		guard.lock();
+
+		if ( --busy == 0 ) {
+			done.notify_one();
+		}
+	}
+}
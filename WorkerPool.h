@@ -0,0 +1,47 @@
+/**********************************
+ * FILE NAME: WorkerPool.h
+ *
+ * DESCRIPTION: Thread pool that runs one simulation phase over all nodes
+ **********************************/
+
+#ifndef WORKERPOOL_H_
+#define WORKERPOOL_H_
+
+#include "stdincludes.h"
+
+/**
+ * CLASS NAME: WorkerPool
+ *
+ * DESCRIPTION: Splits the nodes of a phase into one contiguous range per slot and
+ * 				runs the ranges in parallel. Slot 0 is the calling thread. run()
+ * 				returns once every slot is done, which is the barrier between phases.
+ * 				Code running inside a phase can ask for its slot to keep its side
+ * 				effects apart; merging them in slot order gives the serial order.
+ */
+class WorkerPool {
+private:
+	vector<thread> workers;
+	mutex lock;
+	condition_variable wake;
+	condition_variable done;
+	// work of the current phase
+	function<void(int)> body;
+	int count;
+	// bumped for every phase, a worker runs once per generation
+	long generation;
+	// workers that did not finish the current phase yet
+	int busy;
+	bool stopping;
+	// slot of the calling thread while it runs a phase, -1 otherwise
+	static thread_local int slot;
+	void workerLoop(int workerSlot);
+	void runSlot(int workerSlot);
+public:
+	WorkerPool(int numThreads);
+	virtual ~WorkerPool();
+	int size();
+	void run(int count, function<void(int)> body);
+	static int currentSlot();
+};
+
+#endif /* WORKERPOOL_H_ */
@@ -9,7 +9,7 @@ static int g_transID = 0;
 
 // message types, reply is the message from node to coordinator
 enum MessageType {CREATE, READ, UPDATE, DELETE, REPLY, READREPLY};
-// enum of replica types
-enum ReplicaType {PRIMARY, SECONDARY, TERTIARY};
+// enum of replica types, NO_REPLICA for a message that does not name one
+enum ReplicaType {PRIMARY, SECONDARY, TERTIARY, NO_REPLICA};
 
 #endif
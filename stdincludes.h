@@ -31,10 +31,15 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <string>
 #include <algorithm>
 #include <queue>
 #include <fstream>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 using namespace std;
 